@@ -0,0 +1,330 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "Math/VectorRegister.h"
+#include "Kismet/KismetMathLibrary.h"
+#include "NoiseGeneratorInterface.h"
+
+
+/**
+ * Octave summation shared by the native noise generators.
+ * Sums up the octaves of a single octave noise function (the kernel) with the generator's noise scale, octave offsets,
+ * persistence and lacunarity and normalizes the result to 0..1.
+ * The kernels are passed in as lambdas, so everything here is inlined into the generator.
+ */
+struct FFractalNoise
+{
+	/**
+	 * Moves an octave's origin (in lattice units) by whole periods of the noise, so that it becomes a small float
+	 * without changing the noise. @see FNoiseKernels::WrapPerlinOrigin
+	 */
+	typedef FVector2D (*FWrapOriginFunction)(double x, double y);
+
+	/** Returns the wrapped lattice position of the origin for an octave. */
+	static FORCEINLINE FVector2D GetOctaveOrigin(const UNoiseGenerator& generator, const FNoiseOrigin& origin, float frequency, const FVector2D& octaveOffset,
+		FWrapOriginFunction wrapOrigin)
+	{
+		return wrapOrigin(origin.X / generator.NoiseScale * frequency + octaveOffset.X, origin.Y / generator.NoiseScale * frequency + octaveOffset.Y);
+	}
+
+	/**
+	 * Returns how much an octave contributes when the samples are latticeSpacing lattice cells apart.
+	 * Octaves are faded out once two samples are more than a quarter cell apart and skipped from half a cell on,
+	 * because they can't be represented at that sampling rate anymore (they would only alias).
+	 * The result is still normalized with the full limit, so skipping octaves doesn't change the height range.
+	 */
+	static FORCEINLINE float GetOctaveWeight(float latticeSpacing)
+	{
+		return 1.0f - FMath::SmoothStep(0.25f, 0.5f, latticeSpacing);
+	}
+
+	/* An octave that contributes to a line of samples. */
+	struct FLineOctave
+	{
+		float Frequency;
+
+		/* The amplitude times the octave's weight. @see GetOctaveWeight */
+		float Weight;
+
+		/* @see GetOctaveOrigin */
+		FVector2D Origin;
+	};
+	typedef TArray<FLineOctave, TInlineAllocator<16>> FLineOctaves;
+
+	/**
+	 * Collects the octaves that contribute to a line of samples. Their origins are the same for every sample of the line,
+	 * so they are only calculated once instead of for every block of samples.
+	 */
+	static FORCEINLINE void GetLineOctaves(const UNoiseGenerator& generator, float sampleSpacing, const FNoiseOrigin& origin, FWrapOriginFunction wrapOrigin, 
+		FLineOctaves& outOctaves)
+	{
+		float amplitude = 1.0f;
+		float frequency = 1.0f;
+		for (const FVector2D& octaveOffset : generator.OctaveOffsets)
+		{
+			const float weight = GetOctaveWeight(sampleSpacing / generator.NoiseScale * frequency);
+			if (weight > 0.0f)
+			{
+				outOctaves.Add({ frequency, amplitude * weight, GetOctaveOrigin(generator, origin, frequency, octaveOffset, wrapOrigin) });
+			}
+
+			amplitude *= generator.Persistence;
+			frequency *= generator.Lacunarity;
+		}
+	}
+
+	/**
+	 * @param kernel Single octave noise. Signature: float (FVector2D position)
+	 * @param sampleSpacing, origin @see UNoiseGenerator::GetNoise2DLine
+	 * @param wrapOrigin @see FWrapOriginFunction. Has to match the kernel.
+	 */
+	template<typename KernelType>
+	static FORCEINLINE float Sample(const UNoiseGenerator& generator, float X, float Y, float sampleSpacing, const FNoiseOrigin& origin, FWrapOriginFunction wrapOrigin, 
+		const KernelType& kernel)
+	{
+		float amplitude = 1.0f;
+		float frequency = 1.0f;
+		float noiseHeight = 0.0f;
+
+		for (const FVector2D& octaveOffset : generator.OctaveOffsets)
+		{
+			const float weight = GetOctaveWeight(sampleSpacing / generator.NoiseScale * frequency);
+			if (weight > 0.0f)
+			{
+				const FVector2D octaveOrigin = GetOctaveOrigin(generator, origin, frequency, octaveOffset, wrapOrigin);
+				const float sampleX = X / generator.NoiseScale * frequency + octaveOrigin.X;
+				const float sampleY = Y / generator.NoiseScale * frequency + octaveOrigin.Y;
+
+				const float noiseValue = kernel(FVector2D(sampleX, sampleY));
+				noiseHeight += noiseValue * (amplitude * weight);
+			}
+
+			amplitude *= generator.Persistence;
+			frequency *= generator.Lacunarity;
+		}
+
+		return UKismetMathLibrary::NormalizeToRange(noiseHeight, -generator.Limit, generator.Limit);
+	}
+
+	/**
+	 * Samples a line (@see UNoiseGenerator::GetNoise2DLine), four samples at a time.
+	 * The remaining samples go through the scalar kernel. 
+	 * @param kernel Single octave noise. Signature: float (FVector2D position)
+	 * @param kernel4 Vectorized single octave noise. Signature: VectorRegister (const VectorRegister& X, const VectorRegister& Y)
+	 */
+	template<typename KernelType, typename Kernel4Type>
+	static void SampleLine(const UNoiseGenerator& generator, float* outValues, int32 numValues, float startX, float startY, float stepX, float stepY,
+		float sampleSpacing, const FNoiseOrigin& origin, FWrapOriginFunction wrapOrigin, const KernelType& kernel, const Kernel4Type& kernel4)
+	{
+		FLineOctaves octaves;
+		GetLineOctaves(generator, sampleSpacing, origin, wrapOrigin, octaves);
+
+		int32 i = 0;
+
+		for (; i + 4 <= numValues; i += 4)
+		{
+			/* The position divided by the noise scale doesn't change between octaves,
+			 * so we only have to do the (scalar) division once per sample. */
+			MS_ALIGN(16) float scaledX[4] GCC_ALIGN(16);
+			MS_ALIGN(16) float scaledY[4] GCC_ALIGN(16);
+			for (int32 lane = 0; lane < 4; ++lane)
+			{
+				scaledX[lane] = (startX + (i + lane) * stepX) / generator.NoiseScale;
+				scaledY[lane] = (startY + (i + lane) * stepY) / generator.NoiseScale;
+			}
+
+			const VectorRegister X = VectorLoadAligned(scaledX);
+			const VectorRegister Y = VectorLoadAligned(scaledY);
+
+			VectorRegister noiseHeight = VectorZero();
+			for (const FLineOctave& octave : octaves)
+			{
+				const VectorRegister sampleX = VectorAdd(VectorMultiply(X, VectorSetFloat1(octave.Frequency)), VectorSetFloat1(octave.Origin.X));
+				const VectorRegister sampleY = VectorAdd(VectorMultiply(Y, VectorSetFloat1(octave.Frequency)), VectorSetFloat1(octave.Origin.Y));
+
+				const VectorRegister noiseValue = kernel4(sampleX, sampleY);
+				noiseHeight = VectorAdd(noiseHeight, VectorMultiply(noiseValue, VectorSetFloat1(octave.Weight)));
+			}
+
+			VectorStore(noiseHeight, outValues + i);
+			for (int32 lane = 0; lane < 4; ++lane)
+			{
+				outValues[i + lane] = UKismetMathLibrary::NormalizeToRange(outValues[i + lane], -generator.Limit, generator.Limit);
+			}
+		}
+
+		/* Remaining samples */
+		for (; i < numValues; ++i)
+		{
+			const float X = (startX + i * stepX) / generator.NoiseScale;
+			const float Y = (startY + i * stepY) / generator.NoiseScale;
+			float noiseHeight = 0.0f;
+			for (const FLineOctave& octave : octaves)
+			{
+				noiseHeight += kernel(FVector2D(X * octave.Frequency + octave.Origin.X, Y * octave.Frequency + octave.Origin.Y)) * octave.Weight;
+			}
+			outValues[i] = UKismetMathLibrary::NormalizeToRange(noiseHeight, -generator.Limit, generator.Limit);
+		}
+	}
+
+	/**
+	 * Samples a line like SampleLine and also returns the partial derivatives of the (normalized) noise with respect to X and Y.
+	 * The last block is padded to four samples, so there is no scalar version of the kernel needed.
+	 * @param kernel4 Vectorized single octave noise with derivatives.
+	 * Signature: VectorRegister (const VectorRegister& X, const VectorRegister& Y, VectorRegister& outDerivativeX, VectorRegister& outDerivativeY)
+	 */
+	template<typename Kernel4Type>
+	static void SampleLineWithDerivatives(const UNoiseGenerator& generator, float* outValues, float* outDerivativesX, float* outDerivativesY, int32 numValues,
+		float startX, float startY, float stepX, float stepY, float sampleSpacing, const FNoiseOrigin& origin, FWrapOriginFunction wrapOrigin, const Kernel4Type& kernel4)
+	{
+		/* Normalizing to 0..1 maps -Limit..Limit linearly, so the derivatives are just scaled. The sample positions are divided by the noise scale. */
+		const VectorRegister derivativeScale = VectorSetFloat1(1.0f / (2.0f * generator.Limit * generator.NoiseScale));
+
+		FLineOctaves octaves;
+		GetLineOctaves(generator, sampleSpacing, origin, wrapOrigin, octaves);
+
+		for (int32 i = 0; i < numValues; i += 4)
+		{
+			MS_ALIGN(16) float scaledX[4] GCC_ALIGN(16);
+			MS_ALIGN(16) float scaledY[4] GCC_ALIGN(16);
+			for (int32 lane = 0; lane < 4; ++lane)
+			{
+				scaledX[lane] = (startX + (i + lane) * stepX) / generator.NoiseScale;
+				scaledY[lane] = (startY + (i + lane) * stepY) / generator.NoiseScale;
+			}
+
+			const VectorRegister X = VectorLoadAligned(scaledX);
+			const VectorRegister Y = VectorLoadAligned(scaledY);
+
+			VectorRegister noiseHeight = VectorZero();
+			VectorRegister derivativeX = VectorZero();
+			VectorRegister derivativeY = VectorZero();
+			for (const FLineOctave& octave : octaves)
+			{
+				const VectorRegister sampleX = VectorAdd(VectorMultiply(X, VectorSetFloat1(octave.Frequency)), VectorSetFloat1(octave.Origin.X));
+				const VectorRegister sampleY = VectorAdd(VectorMultiply(Y, VectorSetFloat1(octave.Frequency)), VectorSetFloat1(octave.Origin.Y));
+
+				VectorRegister noiseDerivativeX, noiseDerivativeY;
+				const VectorRegister noiseValue = kernel4(sampleX, sampleY, noiseDerivativeX, noiseDerivativeY);
+
+				/* The octave is sampled at frequency times the position, hence the chain rule factor. */
+				const VectorRegister octaveWeight = VectorSetFloat1(octave.Weight);
+				const VectorRegister octaveSlope = VectorSetFloat1(octave.Weight * octave.Frequency);
+				noiseHeight = VectorAdd(noiseHeight, VectorMultiply(noiseValue, octaveWeight));
+				derivativeX = VectorAdd(derivativeX, VectorMultiply(noiseDerivativeX, octaveSlope));
+				derivativeY = VectorAdd(derivativeY, VectorMultiply(noiseDerivativeY, octaveSlope));
+			}
+
+			MS_ALIGN(16) float values[4] GCC_ALIGN(16);
+			MS_ALIGN(16) float derivativesX[4] GCC_ALIGN(16);
+			MS_ALIGN(16) float derivativesY[4] GCC_ALIGN(16);
+			VectorStoreAligned(noiseHeight, values);
+			VectorStoreAligned(VectorMultiply(derivativeX, derivativeScale), derivativesX);
+			VectorStoreAligned(VectorMultiply(derivativeY, derivativeScale), derivativesY);
+
+			const int32 numLanes = FMath::Min(4, numValues - i);
+			for (int32 lane = 0; lane < numLanes; ++lane)
+			{
+				outValues[i + lane] = UKismetMathLibrary::NormalizeToRange(values[lane], -generator.Limit, generator.Limit);
+				outDerivativesX[i + lane] = derivativesX[lane];
+				outDerivativesY[i + lane] = derivativesY[lane];
+			}
+		}
+	}
+
+	/////////////////////////////////////////////////////
+	/**
+	 * The octave offsets are 2D, so the Z offset is derived from them.
+	 * Drawing extra offsets from the random stream would change the tables and with that the existing 2D terrain.
+	 */
+	static FORCEINLINE float GetOctaveOffsetZ(const FVector2D& octaveOffset)
+	{
+		return octaveOffset.X - octaveOffset.Y;
+	}
+
+	/**
+	 * 3D version of Sample. All octaves are evaluated.
+	 * @param kernel Single octave noise. Signature: float (const FVector& position)
+	 */
+	template<typename KernelType>
+	static FORCEINLINE float Sample3D(const UNoiseGenerator& generator, float X, float Y, float Z, const KernelType& kernel)
+	{
+		float amplitude = 1.0f;
+		float frequency = 1.0f;
+		float noiseHeight = 0.0f;
+
+		for (const FVector2D& octaveOffset : generator.OctaveOffsets)
+		{
+			const float sampleX = X / generator.NoiseScale * frequency + octaveOffset.X;
+			const float sampleY = Y / generator.NoiseScale * frequency + octaveOffset.Y;
+			const float sampleZ = Z / generator.NoiseScale * frequency + GetOctaveOffsetZ(octaveOffset);
+
+			noiseHeight += kernel(FVector(sampleX, sampleY, sampleZ)) * amplitude;
+
+			amplitude *= generator.Persistence;
+			frequency *= generator.Lacunarity;
+		}
+
+		return UKismetMathLibrary::NormalizeToRange(noiseHeight, -generator.Limit, generator.Limit);
+	}
+
+	/**
+	 * Samples a row in X direction (@see UNoiseGenerator::GetNoise3DRow), four samples at a time.
+	 * The octaves are the outer loop, so that the row kernel only has to set up Y and Z once per octave.
+	 * The last block is padded to four samples.
+	 * @param makeRowKernel Creates the row kernel for an octave. Signature: RowKernel (float sampleY, float sampleZ),
+	 * where the row kernel has VectorRegister operator()(const VectorRegister& sampleX).
+	 */
+	template<typename MakeRowKernelType>
+	static void SampleRow3D(const UNoiseGenerator& generator, float* outValues, int32 numValues, float startX, float Y, float Z, float stepX,
+		const MakeRowKernelType& makeRowKernel)
+	{
+		FMemory::Memzero(outValues, numValues * sizeof(float));
+
+		MS_ALIGN(16) const float laneIndices[4] GCC_ALIGN(16) = { 0.0f, 1.0f, 2.0f, 3.0f };
+		const VectorRegister laneSteps = VectorMultiply(VectorLoadAligned(laneIndices), VectorSetFloat1(stepX));
+		const VectorRegister inverseScale = VectorSetFloat1(1.0f / generator.NoiseScale);
+
+		float amplitude = 1.0f;
+		float frequency = 1.0f;
+
+		for (const FVector2D& octaveOffset : generator.OctaveOffsets)
+		{
+			const float sampleY = Y / generator.NoiseScale * frequency + octaveOffset.Y;
+			const float sampleZ = Z / generator.NoiseScale * frequency + GetOctaveOffsetZ(octaveOffset);
+			const auto rowKernel = makeRowKernel(sampleY, sampleZ);
+
+			const VectorRegister octaveFrequency = VectorSetFloat1(frequency);
+			const VectorRegister octaveOffsetX = VectorSetFloat1(octaveOffset.X);
+			const VectorRegister octaveAmplitude = VectorSetFloat1(amplitude);
+
+			for (int32 i = 0; i < numValues; i += 4)
+			{
+				const VectorRegister position = VectorAdd(VectorSetFloat1(startX + i * stepX), laneSteps);
+				const VectorRegister sampleX = VectorAdd(VectorMultiply(VectorMultiply(position, inverseScale), octaveFrequency), octaveOffsetX);
+				const VectorRegister noiseValue = VectorMultiply(rowKernel(sampleX), octaveAmplitude);
+
+				if (i + 4 <= numValues)
+				{
+					VectorStore(VectorAdd(VectorLoad(outValues + i), noiseValue), outValues + i);
+				}
+				else
+				{
+					MS_ALIGN(16) float values[4] GCC_ALIGN(16);
+					VectorStoreAligned(noiseValue, values);
+					for (int32 lane = 0; i + lane < numValues; ++lane)
+					{
+						outValues[i + lane] += values[lane];
+					}
+				}
+			}
+
+			amplitude *= generator.Persistence;
+			frequency *= generator.Lacunarity;
+		}
+
+		for (int32 i = 0; i < numValues; ++i)
+		{
+			outValues[i] = UKismetMathLibrary::NormalizeToRange(outValues[i], -generator.Limit, generator.Limit);
+		}
+	}
+};
@@ -0,0 +1,39 @@
+#include "MeshTopology.h"
+#include "MeshData.h"
+#include "SharedCache.h"
+
+
+FTerrainMeshTopology::FTerrainMeshTopology(int32 verticesPerLine) : VerticesPerLine(verticesPerLine)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CalculateTriangles);
+
+	Triangles.SetNumUninitialized((verticesPerLine - 1) * (verticesPerLine - 1) * 6);
+
+	int32 triangleIndex = 0;
+	for (int32 y = 0; y < verticesPerLine - 1; ++y)
+	{
+		for (int32 x = 0; x < verticesPerLine - 1; ++x)
+		{
+			const int32 a = x + y * verticesPerLine;
+			const int32 b = a + 1;
+			const int32 c = a + verticesPerLine;
+			const int32 d = c + 1;
+			Triangles[triangleIndex] = a;
+			Triangles[triangleIndex + 1] = c;
+			Triangles[triangleIndex + 2] = d;
+			Triangles[triangleIndex + 3] = a;
+			Triangles[triangleIndex + 4] = d;
+			Triangles[triangleIndex + 5] = b;
+			triangleIndex += 6;
+		}
+	}
+}
+
+TSharedRef<const FTerrainMeshTopology, ESPMode::ThreadSafe> FTerrainMeshTopology::Get(int32 verticesPerLine)
+{
+	static TSharedCache<int32, FTerrainMeshTopology> cache;
+	return cache.FindOrAdd(verticesPerLine, [verticesPerLine]()
+	{
+		return MakeShared<const FTerrainMeshTopology, ESPMode::ThreadSafe>(verticesPerLine);
+	});
+}
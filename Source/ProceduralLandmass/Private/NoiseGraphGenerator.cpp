@@ -0,0 +1,428 @@
+#include "NoiseGraphGenerator.h"
+#include "NoiseKernels.h"
+#include "FractalNoise.h"
+#include "UnityLibrary.h"
+#include "Curves/CurveFloat.h"
+
+
+/* Number of samples we evaluate per register. Must be a multiple of 4. */
+static const int32 BlockSize = 64;
+
+/* Fixed registers: the sample position relative to the origin (divided by the noise scale) and a register that is always 0. */
+static const int32 PositionXRegister = 0;
+static const int32 PositionYRegister = 1;
+static const int32 ZeroRegister = 2;
+static const int32 NumFixedRegisters = 3;
+
+
+/**
+ * Sums up the octaves of a fractal noise node. @see FFractalNoise for the generator wide version.
+ * @param sampleSpacing Distance between the samples, divided by the noise scale. Octaves too fine for it are faded out (@see FFractalNoise::GetOctaveWeight).
+ * @param origin The origin the positions are relative to, divided by the noise scale.
+ * @param wrapOrigin @see FFractalNoise::FWrapOriginFunction. Has to match the kernel.
+ * @param kernel4 Vectorized single octave noise. Signature: VectorRegister (const VectorRegister& X, const VectorRegister& Y)
+ */
+template<typename Kernel4Type>
+static void ExecuteFractal(const ENoiseGraphNodeType type, const float frequency, const float persistence, const float lacunarity,
+	const TArray<FVector2D>& octaveOffsets, const float limit, const float sampleSpacing, const FNoiseOrigin& origin, FFractalNoise::FWrapOriginFunction wrapOrigin,
+	const float* positionX, const float* positionY, float* output, int32 numLanes, const Kernel4Type& kernel4)
+{
+	const VectorRegister one = VectorOne();
+	const VectorRegister two = VectorSetFloat1(2.0f);
+	const VectorRegister normalization = VectorSetFloat1(1.0f / limit);
+
+	for (int32 k = 0; k < numLanes; k += 4)
+	{
+		const VectorRegister X = VectorLoad(positionX + k);
+		const VectorRegister Y = VectorLoad(positionY + k);
+
+		float amplitude = 1.0f;
+		float octaveFrequency = frequency;
+		VectorRegister noiseHeight = VectorZero();
+
+		for (const FVector2D& octaveOffset : octaveOffsets)
+		{
+			const float weight = FFractalNoise::GetOctaveWeight(sampleSpacing * octaveFrequency);
+			if (weight <= 0.0f)
+			{
+				amplitude *= persistence;
+				octaveFrequency *= lacunarity;
+				continue;
+			}
+
+			const FVector2D octaveOrigin = wrapOrigin(origin.X * octaveFrequency + octaveOffset.X, origin.Y * octaveFrequency + octaveOffset.Y);
+			const VectorRegister sampleX = VectorAdd(VectorMultiply(X, VectorSetFloat1(octaveFrequency)), VectorSetFloat1(octaveOrigin.X));
+			const VectorRegister sampleY = VectorAdd(VectorMultiply(Y, VectorSetFloat1(octaveFrequency)), VectorSetFloat1(octaveOrigin.Y));
+
+			VectorRegister noiseValue = kernel4(sampleX, sampleY);
+			if (type == ENoiseGraphNodeType::Ridged)
+			{
+				noiseValue = VectorSubtract(one, VectorAbs(noiseValue));
+				noiseValue = VectorMultiply(noiseValue, noiseValue);
+			}
+			else if (type == ENoiseGraphNodeType::Billow)
+			{
+				noiseValue = VectorSubtract(VectorMultiply(VectorAbs(noiseValue), two), one);
+			}
+
+			noiseHeight = VectorAdd(noiseHeight, VectorMultiply(noiseValue, VectorSetFloat1(amplitude * weight)));
+
+			amplitude *= persistence;
+			octaveFrequency *= lacunarity;
+		}
+
+		noiseHeight = VectorMultiply(noiseHeight, normalization);
+		if (type == ENoiseGraphNodeType::Ridged)
+		{
+			/* Ridges are summed up in 0..1. */
+			noiseHeight = VectorSubtract(VectorMultiply(noiseHeight, two), one);
+		}
+
+		VectorStore(noiseHeight, output + k);
+	}
+}
+
+
+/////////////////////////////////////////////////////
+void UNoiseGraphGenerator::PostInitProperties()
+{
+	Super::PostInitProperties();
+	CompileGraph();
+}
+
+#if WITH_EDITOR
+void UNoiseGraphGenerator::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+	CompileGraph();
+}
+#endif
+
+void UNoiseGraphGenerator::CopyGenerator_Implementation(const UNoiseGenerator* otherGenerator)
+{
+	Super::CopyGenerator_Implementation(otherGenerator);
+
+	const UNoiseGraphGenerator* otherGraph = Cast<UNoiseGraphGenerator>(otherGenerator);
+	if (otherGraph)
+	{
+		Nodes = otherGraph->Nodes;
+	}
+
+	CompileGraph();
+}
+
+/////////////////////////////////////////////////////
+void UNoiseGraphGenerator::CompileGraph()
+{
+	Program.Empty(Nodes.Num());
+	NumRegisters = NumFixedRegisters;
+	OutputRegister = ZeroRegister;
+
+	FRandomStream rand(Seed);
+	Tables = FPerlinNoiseTables::Get(Seed);
+
+	TArray<int32> nodeRegisters;
+	nodeRegisters.Init(ZeroRegister, Nodes.Num());
+
+	/* Returns the register of the input node. Invalid inputs read 0. */
+	const auto GetInputRegister = [&](int32 nodeIndex, int32 inputIndex) -> int32
+	{
+		if (inputIndex == INDEX_NONE)
+		{
+			return ZeroRegister;
+		}
+
+		if (inputIndex < 0 || inputIndex >= nodeIndex || Nodes[inputIndex].Type == ENoiseGraphNodeType::DomainWarp)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s: Node %d has an invalid input %d. Inputs must be earlier nodes and not domain warps."), *GetName(), nodeIndex, inputIndex);
+			return ZeroRegister;
+		}
+
+		return nodeRegisters[inputIndex];
+	};
+
+	for (int32 i = 0; i < Nodes.Num(); ++i)
+	{
+		const FNoiseGraphNode& node = Nodes[i];
+
+		FInstruction instruction;
+		instruction.Node = node;
+		instruction.InputA = GetInputRegister(i, node.InputA);
+		instruction.InputB = GetInputRegister(i, node.InputB);
+		instruction.InputC = GetInputRegister(i, node.InputC);
+
+		instruction.CoordinatesX = PositionXRegister;
+		instruction.CoordinatesY = PositionYRegister;
+		if (node.Coordinates != INDEX_NONE)
+		{
+			if (node.Coordinates >= 0 && node.Coordinates < i && Nodes[node.Coordinates].Type == ENoiseGraphNodeType::DomainWarp)
+			{
+				instruction.CoordinatesX = nodeRegisters[node.Coordinates];
+				instruction.CoordinatesY = nodeRegisters[node.Coordinates] + 1;
+			}
+			else
+			{
+				UE_LOG(LogTemp, Warning, TEXT("%s: Node %d has invalid coordinates %d. Coordinates must be an earlier domain warp node."), *GetName(), i, node.Coordinates);
+			}
+		}
+
+		/* Domain warps output a position (two registers), everything else a single value. */
+		instruction.Output = NumRegisters;
+		nodeRegisters[i] = NumRegisters;
+		NumRegisters += node.Type == ENoiseGraphNodeType::DomainWarp ? 2 : 1;
+
+		switch (node.Type)
+		{
+		case ENoiseGraphNodeType::Noise:
+		case ENoiseGraphNodeType::Fbm:
+		case ENoiseGraphNodeType::Ridged:
+		case ENoiseGraphNodeType::Billow:
+		{
+			const int32 numOctaves = node.Type == ENoiseGraphNodeType::Noise ? 1 : FMath::Max(node.Octaves, 1);
+			instruction.OctaveOffsets.SetNum(numOctaves);
+			instruction.Limit = 0.0f;
+			for (int32 octave = 0; octave < numOctaves; ++octave)
+			{
+				const float offsetX = rand.FRandRange(-1000.0f, 1000.0f);
+				const float offsetY = rand.FRandRange(-1000.0f, 1000.0f);
+				instruction.OctaveOffsets[octave] = FVector2D(offsetX, offsetY);
+				instruction.Limit += FMath::Pow(node.Persistence, octave);
+			}
+			break;
+		}
+		case ENoiseGraphNodeType::DomainWarp:
+			/* The positions in the registers are divided by the noise scale, the strength is in world units. */
+			instruction.Node.Strength = node.Strength / NoiseScale;
+			break;
+		case ENoiseGraphNodeType::Curve:
+			if (node.Curve)
+			{
+				float minTime, maxTime;
+				node.Curve->GetTimeRange(minTime, maxTime);
+				instruction.CurveTable = MakeShared<const FHeightCurveTable, ESPMode::ThreadSafe>(*node.Curve, minTime, maxTime);
+			}
+			instruction.Node.Curve = nullptr;
+			break;
+		default:
+			break;
+		}
+
+		Program.Add(instruction);
+	}
+
+	if (Nodes.Num() > 0)
+	{
+		if (Nodes.Last().Type == ENoiseGraphNodeType::DomainWarp)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("%s: The last node is the output and can't be a domain warp."), *GetName());
+		}
+		else
+		{
+			OutputRegister = nodeRegisters.Last();
+		}
+	}
+}
+
+/////////////////////////////////////////////////////
+float UNoiseGraphGenerator::GetNoise2D_Implementation(float X, float Y) const
+{
+	float value = 0.0f;
+	GetNoise2DLine(&value, 1, X, Y, 0.0f, 0.0f);
+	return value;
+}
+
+void UNoiseGraphGenerator::GetNoise2DLine(float* outValues, int32 numValues, float startX, float startY, float stepX, float stepY, float sampleSpacing,
+	const FNoiseOrigin& origin) const
+{
+	const FNoiseOrigin scaledOrigin(origin.X / NoiseScale, origin.Y / NoiseScale);
+
+	/* The registers are local, so the same generator can be sampled from multiple threads. */
+	TArray<float> registers;
+	registers.SetNumUninitialized(NumRegisters * BlockSize);
+	FMemory::Memzero(registers.GetData() + ZeroRegister * BlockSize, BlockSize * sizeof(float));
+
+	float* positionX = registers.GetData() + PositionXRegister * BlockSize;
+	float* positionY = registers.GetData() + PositionYRegister * BlockSize;
+	const float* output = registers.GetData() + OutputRegister * BlockSize;
+
+	for (int32 blockStart = 0; blockStart < numValues; blockStart += BlockSize)
+	{
+		const int32 numSamples = FMath::Min(BlockSize, numValues - blockStart);
+		const int32 numLanes = Align(numSamples, 4);
+
+		/* Lanes behind the last sample just continue the line. Their results are thrown away. */
+		for (int32 k = 0; k < numLanes; ++k)
+		{
+			positionX[k] = (startX + (blockStart + k) * stepX) / NoiseScale;
+			positionY[k] = (startY + (blockStart + k) * stepY) / NoiseScale;
+		}
+
+		for (const FInstruction& instruction : Program)
+		{
+			Execute(instruction, registers.GetData(), numLanes, sampleSpacing / NoiseScale, scaledOrigin);
+		}
+
+		for (int32 k = 0; k < numSamples; ++k)
+		{
+			outValues[blockStart + k] = FMath::Clamp(output[k], 0.0f, 1.0f);
+		}
+	}
+}
+
+void UNoiseGraphGenerator::Execute(const FInstruction& instruction, float* registers, int32 numLanes, float sampleSpacing, const FNoiseOrigin& origin) const
+{
+	const FNoiseGraphNode& node = instruction.Node;
+
+	float* output = registers + instruction.Output * BlockSize;
+	const float* a = registers + instruction.InputA * BlockSize;
+	const float* b = registers + instruction.InputB * BlockSize;
+	const float* c = registers + instruction.InputC * BlockSize;
+	const float* positionX = registers + instruction.CoordinatesX * BlockSize;
+	const float* positionY = registers + instruction.CoordinatesY * BlockSize;
+
+	switch (node.Type)
+	{
+	case ENoiseGraphNodeType::Constant:
+		for (int32 k = 0; k < numLanes; ++k)
+		{
+			output[k] = node.Value;
+		}
+		break;
+
+	case ENoiseGraphNodeType::Noise:
+	case ENoiseGraphNodeType::Fbm:
+	case ENoiseGraphNodeType::Ridged:
+	case ENoiseGraphNodeType::Billow:
+	{
+		const FPerlinNoiseTables& tables = *Tables;
+		if (node.Source == ENoiseGraphSource::Simplex)
+		{
+			ExecuteFractal(node.Type, node.Frequency, node.Persistence, node.Lacunarity, instruction.OctaveOffsets, instruction.Limit, sampleSpacing,
+				origin, &FNoiseKernels::WrapSimplexOrigin, positionX, positionY, output, numLanes,
+				[&tables](const VectorRegister& X, const VectorRegister& Y) { return FNoiseKernels::Simplex4(tables, X, Y); });
+		}
+		else
+		{
+			ExecuteFractal(node.Type, node.Frequency, node.Persistence, node.Lacunarity, instruction.OctaveOffsets, instruction.Limit, sampleSpacing,
+				origin, &FNoiseKernels::WrapPerlinOrigin, positionX, positionY, output, numLanes,
+				[&tables](const VectorRegister& X, const VectorRegister& Y) { return FNoiseKernels::Perlin4(tables, X, Y); });
+		}
+		break;
+	}
+
+	case ENoiseGraphNodeType::DomainWarp:
+	{
+		float* warpedX = output;
+		float* warpedY = output + BlockSize;
+		const VectorRegister strength = VectorSetFloat1(node.Strength);
+		for (int32 k = 0; k < numLanes; k += 4)
+		{
+			VectorStore(VectorAdd(VectorLoad(positionX + k), VectorMultiply(VectorLoad(a + k), strength)), warpedX + k);
+			VectorStore(VectorAdd(VectorLoad(positionY + k), VectorMultiply(VectorLoad(b + k), strength)), warpedY + k);
+		}
+		break;
+	}
+
+	case ENoiseGraphNodeType::Curve:
+		if (instruction.CurveTable.IsValid())
+		{
+			const FHeightCurveTable& curveTable = *instruction.CurveTable;
+			for (int32 k = 0; k < numLanes; ++k)
+			{
+				output[k] = curveTable.Evaluate(a[k]);
+			}
+		}
+		else
+		{
+			FMemory::Memcpy(output, a, numLanes * sizeof(float));
+		}
+		break;
+
+	case ENoiseGraphNodeType::Add:
+		for (int32 k = 0; k < numLanes; k += 4)
+		{
+			VectorStore(VectorAdd(VectorLoad(a + k), VectorLoad(b + k)), output + k);
+		}
+		break;
+
+	case ENoiseGraphNodeType::Subtract:
+		for (int32 k = 0; k < numLanes; k += 4)
+		{
+			VectorStore(VectorSubtract(VectorLoad(a + k), VectorLoad(b + k)), output + k);
+		}
+		break;
+
+	case ENoiseGraphNodeType::Multiply:
+		for (int32 k = 0; k < numLanes; k += 4)
+		{
+			VectorStore(VectorMultiply(VectorLoad(a + k), VectorLoad(b + k)), output + k);
+		}
+		break;
+
+	case ENoiseGraphNodeType::Min:
+		for (int32 k = 0; k < numLanes; k += 4)
+		{
+			VectorStore(VectorMin(VectorLoad(a + k), VectorLoad(b + k)), output + k);
+		}
+		break;
+
+	case ENoiseGraphNodeType::Max:
+		for (int32 k = 0; k < numLanes; k += 4)
+		{
+			VectorStore(VectorMax(VectorLoad(a + k), VectorLoad(b + k)), output + k);
+		}
+		break;
+
+	case ENoiseGraphNodeType::Lerp:
+		for (int32 k = 0; k < numLanes; k += 4)
+		{
+			const VectorRegister valueA = VectorLoad(a + k);
+			VectorStore(VectorAdd(valueA, VectorMultiply(VectorLoad(c + k), VectorSubtract(VectorLoad(b + k), valueA))), output + k);
+		}
+		break;
+
+	case ENoiseGraphNodeType::ScaleBias:
+	{
+		const VectorRegister scale = VectorSetFloat1(node.Scale);
+		const VectorRegister bias = VectorSetFloat1(node.Bias);
+		for (int32 k = 0; k < numLanes; k += 4)
+		{
+			VectorStore(VectorAdd(VectorMultiply(VectorLoad(a + k), scale), bias), output + k);
+		}
+		break;
+	}
+
+	case ENoiseGraphNodeType::Abs:
+		for (int32 k = 0; k < numLanes; k += 4)
+		{
+			VectorStore(VectorAbs(VectorLoad(a + k)), output + k);
+		}
+		break;
+
+	case ENoiseGraphNodeType::Clamp:
+	{
+		const VectorRegister clampMin = VectorSetFloat1(node.ClampMin);
+		const VectorRegister clampMax = VectorSetFloat1(node.ClampMax);
+		for (int32 k = 0; k < numLanes; k += 4)
+		{
+			VectorStore(VectorMin(VectorMax(VectorLoad(a + k), clampMin), clampMax), output + k);
+		}
+		break;
+	}
+
+	case ENoiseGraphNodeType::Falloff:
+	{
+		/* The positions are divided by the noise scale, the falloff size is in world units.
+		 * The falloff is centered on the world origin, so we need the absolute position. */
+		const float halfSize = node.FalloffSize / (2.0f * NoiseScale);
+		for (int32 k = 0; k < numLanes; ++k)
+		{
+			const float absoluteX = origin.X + positionX[k];
+			const float absoluteY = origin.Y + positionY[k];
+			const float distance = FMath::Max(FMath::Abs(absoluteX), FMath::Abs(absoluteY)) / halfSize;
+			output[k] = UUnityLibrary::EvaluateFalloff(FMath::Min(distance, 1.0f));
+		}
+		break;
+	}
+	}
+}
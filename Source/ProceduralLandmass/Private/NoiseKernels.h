@@ -0,0 +1,760 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "Math/VectorRegister.h"
+#include "PerlinNoiseTables.h"
+
+
+/**
+ * Single octave noise functions, shared by the native noise generators.
+ * Each kernel has a scalar and a vectorized version that evaluates four samples at once. The vectorized versions do
+ * the same floating point operations in the same order as the scalar ones, so the results are bit-identical as long as
+ * the compiler doesn't contract the scalar code into fused multiply-adds. If it does, they differ by a few ULP (< 1e-6).
+ * They use the engine's vector intrinsics, so they run on SSE, NEON or the engine's scalar FPU fallback.
+ */
+struct FNoiseKernels
+{
+	static const int32 N = 4096;
+	static const int32 BM = FPerlinNoiseTables::BM;
+
+	/* Skew and unskew factors for 2D simplex noise: (sqrt(3) - 1) / 2 and (3 - sqrt(3)) / 6 */
+	static constexpr float F2 = 0.366025403784f;
+	static constexpr float G2 = 0.211324865405f;
+
+	/* Squared simplex kernel radius and the factor that scales the output to -1..1 (OpenSimplex2). */
+	static constexpr float RSquared = 0.5f;
+	static constexpr float Normalization = 99.83685446303647f;
+
+	/* The same for 3D simplex noise: 1 / 3 and 1 / 6, the squared kernel radius (any larger and the noise isn't continuous
+	 * on this lattice) and the factor that scales the output to -1..1 (measured with the random unit gradients of the tables). */
+	static constexpr float F3 = 0.333333333333f;
+	static constexpr float G3 = 0.166666666667f;
+	static constexpr float RSquared3D = 0.5f;
+	static constexpr float Normalization3D = 106.0f;
+
+	/////////////////////////////////////////////////////
+	/**
+	 * Perlin noise repeats every B lattice cells. Moves a (double precision) lattice position by whole periods into 0..B,
+	 * so that it fits into a float without losing precision, no matter how far away from the origin it is.
+	 */
+	static FORCEINLINE FVector2D WrapPerlinOrigin(double x, double y)
+	{
+		const double period = FPerlinNoiseTables::B;
+		return FVector2D((float)(x - FMath::FloorToDouble(x / period) * period), (float)(y - FMath::FloorToDouble(y / period) * period));
+	}
+
+	/**
+	 * Simplex noise repeats every B cells of the skewed lattice, which aren't whole numbers in input space.
+	 * So we wrap the position in skewed space and unskew it again (with the same factors as the kernel).
+	 */
+	static FORCEINLINE FVector2D WrapSimplexOrigin(double x, double y)
+	{
+		const double period = FPerlinNoiseTables::B;
+		const double skew = (x + y) * (double)F2;
+		const double periodsX = FMath::FloorToDouble((x + skew) / period) * period;
+		const double periodsY = FMath::FloorToDouble((y + skew) / period) * period;
+		const double unskew = (periodsX + periodsY) * (double)G2;
+		return FVector2D((float)(x - (periodsX - unskew)), (float)(y - (periodsY - unskew)));
+	}
+
+	/////////////////////////////////////////////////////
+	/** Implementation of 2D Perlin noise based on Ken Perlin's original version (http://mrl.nyu.edu/~perlin/doc/oscar.html) */
+	static FORCEINLINE float Perlin(const FPerlinNoiseTables& tables, FVector2D vec)
+	{
+		const auto sCurve = [](float t) -> float
+		{
+			return t * t * (3.0f - 2.0f * t);
+		};
+
+		const auto setup = [=](int32 i, int32& b0, int32& b1, float& r0, float& r1, float& t) -> void
+		{
+			t = vec[i] + N;
+			b0 = ((int32)t) & BM;
+			b1 = (b0 + 1) & BM;
+			r0 = t - (int32)t;
+			r1 = r0 - 1.0f;
+		};
+
+		const auto at2 = [](float rx, float ry, const FVector2D& q) -> float
+		{
+			return rx * q[0] + ry * q[1];
+		};
+
+		int32 bx0, bx1, by0, by1, b00, b10, b01, b11;
+		float rx0, rx1, ry0, ry1, sx, sy, a, b, t, u, v;
+		FVector2D q;
+		int32 i, j;
+
+		setup(0, bx0, bx1, rx0, rx1, t);
+		setup(1, by0, by1, ry0, ry1, t);
+
+		const uint8* p = tables.Permutation;
+		const FVector2D* g2 = tables.Gradients2D;
+
+		i = p[bx0];
+		j = p[bx1];
+
+		b00 = p[i + by0];
+		b10 = p[j + by0];
+		b01 = p[i + by1];
+		b11 = p[j + by1];
+
+		sx = sCurve(rx0);
+		sy = sCurve(ry0);
+
+		q = g2[b00];
+		u = at2(rx0, ry0, q);
+		q = g2[b10];
+		v = at2(rx1, ry0, q);
+		a = FMath::Lerp(u, v, sx);
+
+		q = g2[b01]; u = at2(rx0, ry1, q);
+		q = g2[b11]; v = at2(rx1, ry1, q);
+		b = FMath::Lerp(u, v, sx);
+
+		return FMath::Lerp(a, b, sy);
+	}
+
+	/** Position inside the lattice cell and the four corner gradients of four Perlin noise samples. */
+	struct FPerlinCell4
+	{
+		VectorRegister RX0, RY0, RX1, RY1;
+		VectorRegister G00X, G00Y, G10X, G10Y, G01X, G01Y, G11X, G11Y;
+	};
+
+	static FORCEINLINE void GetPerlinCell4(const FPerlinNoiseTables& tables, const VectorRegister& X, const VectorRegister& Y, FPerlinCell4& cell)
+	{
+		const VectorRegister offset = VectorSetFloat1(N);
+		const VectorRegister one = VectorOne();
+
+		/* Setup */
+		const VectorRegister tx = VectorAdd(X, offset);
+		const VectorRegister ty = VectorAdd(Y, offset);
+		cell.RX0 = VectorSubtract(tx, VectorTruncate(tx));
+		cell.RY0 = VectorSubtract(ty, VectorTruncate(ty));
+		cell.RX1 = VectorSubtract(cell.RX0, one);
+		cell.RY1 = VectorSubtract(cell.RY0, one);
+
+		MS_ALIGN(16) int32 latticeX[4] GCC_ALIGN(16);
+		MS_ALIGN(16) int32 latticeY[4] GCC_ALIGN(16);
+		VectorIntStoreAligned(VectorFloatToInt(tx), latticeX);
+		VectorIntStoreAligned(VectorFloatToInt(ty), latticeY);
+
+		/* The permutation lookups can't be vectorized, so we gather the four corner gradients lane by lane. */
+		MS_ALIGN(16) float q00x[4] GCC_ALIGN(16); MS_ALIGN(16) float q00y[4] GCC_ALIGN(16);
+		MS_ALIGN(16) float q10x[4] GCC_ALIGN(16); MS_ALIGN(16) float q10y[4] GCC_ALIGN(16);
+		MS_ALIGN(16) float q01x[4] GCC_ALIGN(16); MS_ALIGN(16) float q01y[4] GCC_ALIGN(16);
+		MS_ALIGN(16) float q11x[4] GCC_ALIGN(16); MS_ALIGN(16) float q11y[4] GCC_ALIGN(16);
+
+		const uint8* permutation = tables.Permutation;
+		const FVector2D* gradients = tables.Gradients2D;
+		for (int32 lane = 0; lane < 4; ++lane)
+		{
+			const int32 bx0 = latticeX[lane] & BM;
+			const int32 bx1 = (bx0 + 1) & BM;
+			const int32 by0 = latticeY[lane] & BM;
+			const int32 by1 = (by0 + 1) & BM;
+
+			const int32 i = permutation[bx0];
+			const int32 j = permutation[bx1];
+
+			const FVector2D& g00 = gradients[permutation[i + by0]];
+			const FVector2D& g10 = gradients[permutation[j + by0]];
+			const FVector2D& g01 = gradients[permutation[i + by1]];
+			const FVector2D& g11 = gradients[permutation[j + by1]];
+
+			q00x[lane] = g00.X; q00y[lane] = g00.Y;
+			q10x[lane] = g10.X; q10y[lane] = g10.Y;
+			q01x[lane] = g01.X; q01y[lane] = g01.Y;
+			q11x[lane] = g11.X; q11y[lane] = g11.Y;
+		}
+
+		cell.G00X = VectorLoadAligned(q00x); cell.G00Y = VectorLoadAligned(q00y);
+		cell.G10X = VectorLoadAligned(q10x); cell.G10Y = VectorLoadAligned(q10y);
+		cell.G01X = VectorLoadAligned(q01x); cell.G01Y = VectorLoadAligned(q01y);
+		cell.G11X = VectorLoadAligned(q11x); cell.G11Y = VectorLoadAligned(q11y);
+	}
+
+	static FORCEINLINE VectorRegister Perlin4(const FPerlinNoiseTables& tables, const VectorRegister& X, const VectorRegister& Y)
+	{
+		const VectorRegister two = VectorSetFloat1(2.0f);
+		const VectorRegister three = VectorSetFloat1(3.0f);
+
+		FPerlinCell4 cell;
+		GetPerlinCell4(tables, X, Y, cell);
+
+		/* sCurve */
+		const VectorRegister sx = VectorMultiply(VectorMultiply(cell.RX0, cell.RX0), VectorSubtract(three, VectorMultiply(two, cell.RX0)));
+		const VectorRegister sy = VectorMultiply(VectorMultiply(cell.RY0, cell.RY0), VectorSubtract(three, VectorMultiply(two, cell.RY0)));
+
+		/* at2 and lerp */
+		VectorRegister u = VectorAdd(VectorMultiply(cell.RX0, cell.G00X), VectorMultiply(cell.RY0, cell.G00Y));
+		VectorRegister v = VectorAdd(VectorMultiply(cell.RX1, cell.G10X), VectorMultiply(cell.RY0, cell.G10Y));
+		const VectorRegister a = VectorAdd(u, VectorMultiply(sx, VectorSubtract(v, u)));
+
+		u = VectorAdd(VectorMultiply(cell.RX0, cell.G01X), VectorMultiply(cell.RY1, cell.G01Y));
+		v = VectorAdd(VectorMultiply(cell.RX1, cell.G11X), VectorMultiply(cell.RY1, cell.G11Y));
+		const VectorRegister b = VectorAdd(u, VectorMultiply(sx, VectorSubtract(v, u)));
+
+		return VectorAdd(a, VectorMultiply(sy, VectorSubtract(b, a)));
+	}
+
+	/**
+	 * Perlin4 that also returns the analytic partial derivatives of the noise with respect to X and Y.
+	 * The s-curve has a zero slope at the cell borders, so the derivatives are continuous.
+	 */
+	static FORCEINLINE VectorRegister Perlin4WithDerivatives(const FPerlinNoiseTables& tables, const VectorRegister& X, const VectorRegister& Y,
+		VectorRegister& outDerivativeX, VectorRegister& outDerivativeY)
+	{
+		const VectorRegister one = VectorOne();
+		const VectorRegister two = VectorSetFloat1(2.0f);
+		const VectorRegister three = VectorSetFloat1(3.0f);
+		const VectorRegister six = VectorSetFloat1(6.0f);
+
+		FPerlinCell4 cell;
+		GetPerlinCell4(tables, X, Y, cell);
+
+		/* sCurve and its slope */
+		const VectorRegister sx = VectorMultiply(VectorMultiply(cell.RX0, cell.RX0), VectorSubtract(three, VectorMultiply(two, cell.RX0)));
+		const VectorRegister sy = VectorMultiply(VectorMultiply(cell.RY0, cell.RY0), VectorSubtract(three, VectorMultiply(two, cell.RY0)));
+		const VectorRegister dsx = VectorMultiply(VectorMultiply(six, cell.RX0), VectorSubtract(one, cell.RX0));
+		const VectorRegister dsy = VectorMultiply(VectorMultiply(six, cell.RY0), VectorSubtract(one, cell.RY0));
+
+		/* Corner values */
+		const VectorRegister u00 = VectorAdd(VectorMultiply(cell.RX0, cell.G00X), VectorMultiply(cell.RY0, cell.G00Y));
+		const VectorRegister u10 = VectorAdd(VectorMultiply(cell.RX1, cell.G10X), VectorMultiply(cell.RY0, cell.G10Y));
+		const VectorRegister u01 = VectorAdd(VectorMultiply(cell.RX0, cell.G01X), VectorMultiply(cell.RY1, cell.G01Y));
+		const VectorRegister u11 = VectorAdd(VectorMultiply(cell.RX1, cell.G11X), VectorMultiply(cell.RY1, cell.G11Y));
+
+		const VectorRegister a = VectorAdd(u00, VectorMultiply(sx, VectorSubtract(u10, u00)));
+		const VectorRegister b = VectorAdd(u01, VectorMultiply(sx, VectorSubtract(u11, u01)));
+
+		/* Derivatives of the two x lerps. The corner values are linear in x and y, their slopes are the gradients. */
+		const VectorRegister dax = VectorAdd(VectorAdd(cell.G00X, VectorMultiply(sx, VectorSubtract(cell.G10X, cell.G00X))), VectorMultiply(dsx, VectorSubtract(u10, u00)));
+		const VectorRegister dbx = VectorAdd(VectorAdd(cell.G01X, VectorMultiply(sx, VectorSubtract(cell.G11X, cell.G01X))), VectorMultiply(dsx, VectorSubtract(u11, u01)));
+		const VectorRegister day = VectorAdd(cell.G00Y, VectorMultiply(sx, VectorSubtract(cell.G10Y, cell.G00Y)));
+		const VectorRegister dby = VectorAdd(cell.G01Y, VectorMultiply(sx, VectorSubtract(cell.G11Y, cell.G01Y)));
+
+		outDerivativeX = VectorAdd(dax, VectorMultiply(sy, VectorSubtract(dbx, dax)));
+		outDerivativeY = VectorAdd(VectorAdd(day, VectorMultiply(sy, VectorSubtract(dby, day))), VectorMultiply(dsy, VectorSubtract(b, a)));
+
+		return VectorAdd(a, VectorMultiply(sy, VectorSubtract(b, a)));
+	}
+
+	/////////////////////////////////////////////////////
+	/** 2D simplex noise with the OpenSimplex2 kernel. Returns a value between -1 and 1. */
+	static FORCEINLINE float Simplex(const FPerlinNoiseTables& tables, FVector2D vec)
+	{
+		const auto contribution = [](float x, float y, const FVector2D& gradient) -> float
+		{
+			const float a = FMath::Max(RSquared - x * x - y * y, 0.0f);
+			return (a * a) * (a * a) * (x * gradient.X + y * gradient.Y);
+		};
+
+		/* Skew the input space to find the simplex cell we are in. */
+		const float s = (vec.X + vec.Y) * F2;
+		const float i = FMath::FloorToFloat(vec.X + s);
+		const float j = FMath::FloorToFloat(vec.Y + s);
+
+		/* Unskew the cell origin back and get the distances to the three corners. */
+		const float t = (i + j) * G2;
+		const float x0 = vec.X - (i - t);
+		const float y0 = vec.Y - (j - t);
+
+		/* Are we in the upper or lower triangle? */
+		const float i1 = x0 > y0 ? 1.0f : 0.0f;
+		const float j1 = 1.0f - i1;
+
+		const float x1 = x0 - i1 + G2;
+		const float y1 = y0 - j1 + G2;
+		const float x2 = x0 - 1.0f + 2.0f * G2;
+		const float y2 = y0 - 1.0f + 2.0f * G2;
+
+		const uint8* p = tables.Permutation;
+		const FVector2D* g2 = tables.Gradients2D;
+
+		const int32 ii = ((int32)i) & FPerlinNoiseTables::BM;
+		const int32 jj = ((int32)j) & FPerlinNoiseTables::BM;
+		const int32 ii1 = ii + (int32)i1;
+		const int32 jj1 = jj + (int32)j1;
+
+		const float n0 = contribution(x0, y0, g2[p[ii + p[jj]]]);
+		const float n1 = contribution(x1, y1, g2[p[ii1 + p[jj1]]]);
+		const float n2 = contribution(x2, y2, g2[p[ii + 1 + p[jj + 1]]]);
+
+		return (n0 + n1 + n2) * Normalization;
+	}
+
+	/** Distances to the three corners and the three corner gradients of four simplex noise samples. */
+	struct FSimplexCell4
+	{
+		VectorRegister X0, Y0, X1, Y1, X2, Y2;
+		VectorRegister G0X, G0Y, G1X, G1Y, G2X, G2Y;
+	};
+
+	static FORCEINLINE void GetSimplexCell4(const FPerlinNoiseTables& tables, const VectorRegister& X, const VectorRegister& Y, FSimplexCell4& cell)
+	{
+		const VectorRegister one = VectorOne();
+		const VectorRegister unskew = VectorSetFloat1(G2);
+
+		const auto vectorFloor = [&](const VectorRegister& value) -> VectorRegister
+		{
+			const VectorRegister truncated = VectorTruncate(value);
+			return VectorSubtract(truncated, VectorBitwiseAnd(VectorCompareGT(truncated, value), one));
+		};
+
+		/* Skew the input space to find the simplex cell we are in. */
+		const VectorRegister s = VectorMultiply(VectorAdd(X, Y), VectorSetFloat1(F2));
+		const VectorRegister i = vectorFloor(VectorAdd(X, s));
+		const VectorRegister j = vectorFloor(VectorAdd(Y, s));
+
+		/* Unskew the cell origin back and get the distances to the three corners. */
+		const VectorRegister t = VectorMultiply(VectorAdd(i, j), unskew);
+		cell.X0 = VectorSubtract(X, VectorSubtract(i, t));
+		cell.Y0 = VectorSubtract(Y, VectorSubtract(j, t));
+
+		const VectorRegister i1 = VectorBitwiseAnd(VectorCompareGT(cell.X0, cell.Y0), one);
+		const VectorRegister j1 = VectorSubtract(one, i1);
+
+		cell.X1 = VectorAdd(VectorSubtract(cell.X0, i1), unskew);
+		cell.Y1 = VectorAdd(VectorSubtract(cell.Y0, j1), unskew);
+		cell.X2 = VectorAdd(VectorSubtract(cell.X0, one), VectorSetFloat1(2.0f * G2));
+		cell.Y2 = VectorAdd(VectorSubtract(cell.Y0, one), VectorSetFloat1(2.0f * G2));
+
+		MS_ALIGN(16) int32 latticeI[4] GCC_ALIGN(16);
+		MS_ALIGN(16) int32 latticeJ[4] GCC_ALIGN(16);
+		MS_ALIGN(16) int32 offsetI[4] GCC_ALIGN(16);
+		VectorIntStoreAligned(VectorFloatToInt(i), latticeI);
+		VectorIntStoreAligned(VectorFloatToInt(j), latticeJ);
+		VectorIntStoreAligned(VectorFloatToInt(i1), offsetI);
+
+		/* The permutation lookups can't be vectorized, so we gather the three corner gradients lane by lane. */
+		MS_ALIGN(16) float q0x[4] GCC_ALIGN(16); MS_ALIGN(16) float q0y[4] GCC_ALIGN(16);
+		MS_ALIGN(16) float q1x[4] GCC_ALIGN(16); MS_ALIGN(16) float q1y[4] GCC_ALIGN(16);
+		MS_ALIGN(16) float q2x[4] GCC_ALIGN(16); MS_ALIGN(16) float q2y[4] GCC_ALIGN(16);
+
+		const uint8* p = tables.Permutation;
+		const FVector2D* gradients = tables.Gradients2D;
+		for (int32 lane = 0; lane < 4; ++lane)
+		{
+			const int32 ii = latticeI[lane] & FPerlinNoiseTables::BM;
+			const int32 jj = latticeJ[lane] & FPerlinNoiseTables::BM;
+			const int32 ii1 = ii + offsetI[lane];
+			const int32 jj1 = jj + 1 - offsetI[lane];
+
+			const FVector2D& gradient0 = gradients[p[ii + p[jj]]];
+			const FVector2D& gradient1 = gradients[p[ii1 + p[jj1]]];
+			const FVector2D& gradient2 = gradients[p[ii + 1 + p[jj + 1]]];
+
+			q0x[lane] = gradient0.X; q0y[lane] = gradient0.Y;
+			q1x[lane] = gradient1.X; q1y[lane] = gradient1.Y;
+			q2x[lane] = gradient2.X; q2y[lane] = gradient2.Y;
+		}
+
+		cell.G0X = VectorLoadAligned(q0x); cell.G0Y = VectorLoadAligned(q0y);
+		cell.G1X = VectorLoadAligned(q1x); cell.G1Y = VectorLoadAligned(q1y);
+		cell.G2X = VectorLoadAligned(q2x); cell.G2Y = VectorLoadAligned(q2y);
+	}
+
+	static FORCEINLINE VectorRegister Simplex4(const FPerlinNoiseTables& tables, const VectorRegister& X, const VectorRegister& Y)
+	{
+		const VectorRegister zero = VectorZero();
+		const VectorRegister rSquared = VectorSetFloat1(RSquared);
+
+		FSimplexCell4 cell;
+		GetSimplexCell4(tables, X, Y, cell);
+
+		const auto contribution = [&](const VectorRegister& x, const VectorRegister& y, const VectorRegister& gradientX, const VectorRegister& gradientY) -> VectorRegister
+		{
+			const VectorRegister a = VectorMax(VectorSubtract(VectorSubtract(rSquared, VectorMultiply(x, x)), VectorMultiply(y, y)), zero);
+			const VectorRegister aSquared = VectorMultiply(a, a);
+			const VectorRegister dot = VectorAdd(VectorMultiply(x, gradientX), VectorMultiply(y, gradientY));
+			return VectorMultiply(VectorMultiply(aSquared, aSquared), dot);
+		};
+
+		const VectorRegister n0 = contribution(cell.X0, cell.Y0, cell.G0X, cell.G0Y);
+		const VectorRegister n1 = contribution(cell.X1, cell.Y1, cell.G1X, cell.G1Y);
+		const VectorRegister n2 = contribution(cell.X2, cell.Y2, cell.G2X, cell.G2Y);
+
+		return VectorMultiply(VectorAdd(VectorAdd(n0, n1), n2), VectorSetFloat1(Normalization));
+	}
+
+	/** Simplex4 that also returns the analytic partial derivatives of the noise with respect to X and Y. */
+	static FORCEINLINE VectorRegister Simplex4WithDerivatives(const FPerlinNoiseTables& tables, const VectorRegister& X, const VectorRegister& Y,
+		VectorRegister& outDerivativeX, VectorRegister& outDerivativeY)
+	{
+		const VectorRegister zero = VectorZero();
+		const VectorRegister rSquared = VectorSetFloat1(RSquared);
+		const VectorRegister eight = VectorSetFloat1(8.0f);
+
+		FSimplexCell4 cell;
+		GetSimplexCell4(tables, X, Y, cell);
+
+		VectorRegister value = zero;
+		VectorRegister derivativeX = zero;
+		VectorRegister derivativeY = zero;
+
+		/* n = a^4 * dot with a = r^2 - x^2 - y^2, so dn/dx = a^3 * (a * gradientX - 8 * x * dot). Same for y. */
+		const auto addContribution = [&](const VectorRegister& x, const VectorRegister& y, const VectorRegister& gradientX, const VectorRegister& gradientY)
+		{
+			const VectorRegister a = VectorMax(VectorSubtract(VectorSubtract(rSquared, VectorMultiply(x, x)), VectorMultiply(y, y)), zero);
+			const VectorRegister aSquared = VectorMultiply(a, a);
+			const VectorRegister aCubed = VectorMultiply(aSquared, a);
+			const VectorRegister dot = VectorAdd(VectorMultiply(x, gradientX), VectorMultiply(y, gradientY));
+			const VectorRegister eightDot = VectorMultiply(eight, dot);
+
+			value = VectorAdd(value, VectorMultiply(VectorMultiply(aSquared, aSquared), dot));
+			derivativeX = VectorAdd(derivativeX, VectorMultiply(aCubed, VectorSubtract(VectorMultiply(a, gradientX), VectorMultiply(x, eightDot))));
+			derivativeY = VectorAdd(derivativeY, VectorMultiply(aCubed, VectorSubtract(VectorMultiply(a, gradientY), VectorMultiply(y, eightDot))));
+		};
+
+		addContribution(cell.X0, cell.Y0, cell.G0X, cell.G0Y);
+		addContribution(cell.X1, cell.Y1, cell.G1X, cell.G1Y);
+		addContribution(cell.X2, cell.Y2, cell.G2X, cell.G2Y);
+
+		const VectorRegister normalization = VectorSetFloat1(Normalization);
+		outDerivativeX = VectorMultiply(derivativeX, normalization);
+		outDerivativeY = VectorMultiply(derivativeY, normalization);
+		return VectorMultiply(value, normalization);
+	}
+
+	/////////////////////////////////////////////////////
+	/** 3D Perlin noise. Same algorithm as the 2D version, with the 3D gradients. */
+	static FORCEINLINE float Perlin3D(const FPerlinNoiseTables& tables, const FVector& vec)
+	{
+		const auto sCurve = [](float t) -> float
+		{
+			return t * t * (3.0f - 2.0f * t);
+		};
+
+		const auto setup = [=](int32 i, int32& b0, int32& b1, float& r0, float& r1) -> void
+		{
+			const float t = vec[i] + N;
+			b0 = ((int32)t) & BM;
+			b1 = (b0 + 1) & BM;
+			r0 = t - (int32)t;
+			r1 = r0 - 1.0f;
+		};
+
+		/* The hashes go up to 2 * BM, the gradient table only has B entries (the original stores it twice). */
+		const auto at3 = [&](int32 index, float rx, float ry, float rz) -> float
+		{
+			const FVector& q = tables.Gradients3D[index & BM];
+			return rx * q.X + ry * q.Y + rz * q.Z;
+		};
+
+		int32 bx0, bx1, by0, by1, bz0, bz1;
+		float rx0, rx1, ry0, ry1, rz0, rz1;
+
+		setup(0, bx0, bx1, rx0, rx1);
+		setup(1, by0, by1, ry0, ry1);
+		setup(2, bz0, bz1, rz0, rz1);
+
+		const uint8* p = tables.Permutation;
+
+		const int32 i = p[bx0];
+		const int32 j = p[bx1];
+
+		const int32 b00 = p[i + by0];
+		const int32 b10 = p[j + by0];
+		const int32 b01 = p[i + by1];
+		const int32 b11 = p[j + by1];
+
+		const float sx = sCurve(rx0);
+		const float sy = sCurve(ry0);
+		const float sz = sCurve(rz0);
+
+		float a = FMath::Lerp(at3(b00 + bz0, rx0, ry0, rz0), at3(b10 + bz0, rx1, ry0, rz0), sx);
+		float b = FMath::Lerp(at3(b01 + bz0, rx0, ry1, rz0), at3(b11 + bz0, rx1, ry1, rz0), sx);
+		const float c = FMath::Lerp(a, b, sy);
+
+		a = FMath::Lerp(at3(b00 + bz1, rx0, ry0, rz1), at3(b10 + bz1, rx1, ry0, rz1), sx);
+		b = FMath::Lerp(at3(b01 + bz1, rx0, ry1, rz1), at3(b11 + bz1, rx1, ry1, rz1), sx);
+		const float d = FMath::Lerp(a, b, sy);
+
+		return FMath::Lerp(c, d, sz);
+	}
+
+	/**
+	 * Evaluates 3D Perlin noise along a row in X direction, four samples at a time.
+	 * Everything that only depends on Y and Z (their lattice cells, fractions and s-curves) is set up once per row,
+	 * so each sample only has to do the X part.
+	 */
+	struct FPerlin3DRow
+	{
+		FPerlin3DRow(const FPerlinNoiseTables& tables, float Y, float Z) : Tables(tables)
+		{
+			const float ty = Y + N;
+			const float tz = Z + N;
+			BY0 = ((int32)ty) & BM;
+			BY1 = (BY0 + 1) & BM;
+			BZ0 = ((int32)tz) & BM;
+			BZ1 = (BZ0 + 1) & BM;
+
+			const float ry0 = ty - (int32)ty;
+			const float rz0 = tz - (int32)tz;
+			RY0 = VectorSetFloat1(ry0);
+			RY1 = VectorSetFloat1(ry0 - 1.0f);
+			RZ0 = VectorSetFloat1(rz0);
+			RZ1 = VectorSetFloat1(rz0 - 1.0f);
+			SY = VectorSetFloat1(ry0 * ry0 * (3.0f - 2.0f * ry0));
+			SZ = VectorSetFloat1(rz0 * rz0 * (3.0f - 2.0f * rz0));
+		}
+
+		FORCEINLINE VectorRegister operator()(const VectorRegister& X) const
+		{
+			const VectorRegister one = VectorOne();
+			const VectorRegister two = VectorSetFloat1(2.0f);
+			const VectorRegister three = VectorSetFloat1(3.0f);
+
+			const VectorRegister tx = VectorAdd(X, VectorSetFloat1(N));
+			const VectorRegister rx0 = VectorSubtract(tx, VectorTruncate(tx));
+			const VectorRegister rx1 = VectorSubtract(rx0, one);
+
+			MS_ALIGN(16) int32 latticeX[4] GCC_ALIGN(16);
+			VectorIntStoreAligned(VectorFloatToInt(tx), latticeX);
+
+			/* Gather the eight corner gradients lane by lane. Corner c is at (c & 1, (c >> 1) & 1, c >> 2), component k is at c * 3 + k. */
+			MS_ALIGN(16) float q[24][4] GCC_ALIGN(16);
+
+			const uint8* p = Tables.Permutation;
+			const FVector* gradients = Tables.Gradients3D;
+			for (int32 lane = 0; lane < 4; ++lane)
+			{
+				const int32 bx0 = latticeX[lane] & BM;
+				const int32 bx1 = (bx0 + 1) & BM;
+
+				const int32 i = p[bx0];
+				const int32 j = p[bx1];
+
+				const int32 b00 = p[i + BY0];
+				const int32 b10 = p[j + BY0];
+				const int32 b01 = p[i + BY1];
+				const int32 b11 = p[j + BY1];
+
+				const int32 corners[8] = { b00 + BZ0, b10 + BZ0, b01 + BZ0, b11 + BZ0, b00 + BZ1, b10 + BZ1, b01 + BZ1, b11 + BZ1 };
+				for (int32 c = 0; c < 8; ++c)
+				{
+					const FVector& gradient = gradients[corners[c] & BM];
+					q[c * 3][lane] = gradient.X;
+					q[c * 3 + 1][lane] = gradient.Y;
+					q[c * 3 + 2][lane] = gradient.Z;
+				}
+			}
+
+			const auto at3 = [&](int32 c, const VectorRegister& rx, const VectorRegister& ry, const VectorRegister& rz) -> VectorRegister
+			{
+				const VectorRegister xy = VectorAdd(VectorMultiply(rx, VectorLoadAligned(q[c * 3])), VectorMultiply(ry, VectorLoadAligned(q[c * 3 + 1])));
+				return VectorAdd(xy, VectorMultiply(rz, VectorLoadAligned(q[c * 3 + 2])));
+			};
+
+			const auto lerp = [](const VectorRegister& a, const VectorRegister& b, const VectorRegister& t) -> VectorRegister
+			{
+				return VectorAdd(a, VectorMultiply(t, VectorSubtract(b, a)));
+			};
+
+			const VectorRegister sx = VectorMultiply(VectorMultiply(rx0, rx0), VectorSubtract(three, VectorMultiply(two, rx0)));
+
+			VectorRegister a = lerp(at3(0, rx0, RY0, RZ0), at3(1, rx1, RY0, RZ0), sx);
+			VectorRegister b = lerp(at3(2, rx0, RY1, RZ0), at3(3, rx1, RY1, RZ0), sx);
+			const VectorRegister c = lerp(a, b, SY);
+
+			a = lerp(at3(4, rx0, RY0, RZ1), at3(5, rx1, RY0, RZ1), sx);
+			b = lerp(at3(6, rx0, RY1, RZ1), at3(7, rx1, RY1, RZ1), sx);
+			const VectorRegister d = lerp(a, b, SY);
+
+			return lerp(c, d, SZ);
+		}
+
+	private:
+		const FPerlinNoiseTables& Tables;
+		int32 BY0, BY1, BZ0, BZ1;
+		VectorRegister RY0, RY1, RZ0, RZ1, SY, SZ;
+	};
+
+	/////////////////////////////////////////////////////
+	/** 3D simplex noise with the same kernel as the 2D version. Returns a value between -1 and 1. */
+	static FORCEINLINE float Simplex3D(const FPerlinNoiseTables& tables, const FVector& vec)
+	{
+		const auto contribution = [](float x, float y, float z, const FVector& gradient) -> float
+		{
+			const float a = FMath::Max(RSquared3D - x * x - y * y - z * z, 0.0f);
+			return (a * a) * (a * a) * (x * gradient.X + y * gradient.Y + z * gradient.Z);
+		};
+
+		/* Skew the input space to find the simplex cell we are in. */
+		const float s = (vec.X + vec.Y + vec.Z) * F3;
+		const float i = FMath::FloorToFloat(vec.X + s);
+		const float j = FMath::FloorToFloat(vec.Y + s);
+		const float k = FMath::FloorToFloat(vec.Z + s);
+
+		/* Unskew the cell origin back and get the distance to the first corner. */
+		const float t = (i + j + k) * G3;
+		const float x0 = vec.X - (i - t);
+		const float y0 = vec.Y - (j - t);
+		const float z0 = vec.Z - (k - t);
+
+		/* Rank the axes by their distance to find which of the six simplices of the cube we are in.
+		 * The largest axis steps first (second corner), the two largest ones step for the third corner. */
+		const int32 rankX = (x0 >= y0) + (x0 >= z0);
+		const int32 rankY = (y0 > x0) + (y0 >= z0);
+		const int32 rankZ = (z0 > x0) + (z0 > y0);
+
+		const int32 i1 = rankX >= 2, j1 = rankY >= 2, k1 = rankZ >= 2;
+		const int32 i2 = rankX >= 1, j2 = rankY >= 1, k2 = rankZ >= 1;
+
+		const float x1 = x0 - i1 + G3;
+		const float y1 = y0 - j1 + G3;
+		const float z1 = z0 - k1 + G3;
+		const float x2 = x0 - i2 + 2.0f * G3;
+		const float y2 = y0 - j2 + 2.0f * G3;
+		const float z2 = z0 - k2 + 2.0f * G3;
+		const float x3 = x0 - 1.0f + 3.0f * G3;
+		const float y3 = y0 - 1.0f + 3.0f * G3;
+		const float z3 = z0 - 1.0f + 3.0f * G3;
+
+		const uint8* p = tables.Permutation;
+		const FVector* g3 = tables.Gradients3D;
+
+		const int32 ii = ((int32)i) & BM;
+		const int32 jj = ((int32)j) & BM;
+		const int32 kk = ((int32)k) & BM;
+
+		const float n0 = contribution(x0, y0, z0, g3[p[ii + p[jj + p[kk]]]]);
+		const float n1 = contribution(x1, y1, z1, g3[p[ii + i1 + p[jj + j1 + p[kk + k1]]]]);
+		const float n2 = contribution(x2, y2, z2, g3[p[ii + i2 + p[jj + j2 + p[kk + k2]]]]);
+		const float n3 = contribution(x3, y3, z3, g3[p[ii + 1 + p[jj + 1 + p[kk + 1]]]]);
+
+		return (n0 + n1 + n2 + n3) * Normalization3D;
+	}
+
+	static FORCEINLINE VectorRegister Simplex3D4(const FPerlinNoiseTables& tables, const VectorRegister& X, const VectorRegister& Y, const VectorRegister& Z)
+	{
+		const VectorRegister zero = VectorZero();
+		const VectorRegister one = VectorOne();
+		const VectorRegister rSquared = VectorSetFloat1(RSquared3D);
+
+		const auto vectorFloor = [&](const VectorRegister& value) -> VectorRegister
+		{
+			const VectorRegister truncated = VectorTruncate(value);
+			return VectorSubtract(truncated, VectorBitwiseAnd(VectorCompareGT(truncated, value), one));
+		};
+
+		/* a > b as 0 or 1 */
+		const auto greater = [&](const VectorRegister& a, const VectorRegister& b) -> VectorRegister
+		{
+			return VectorBitwiseAnd(VectorCompareGT(a, b), one);
+		};
+
+		/* Skew the input space to find the simplex cell we are in. */
+		const VectorRegister s = VectorMultiply(VectorAdd(VectorAdd(X, Y), Z), VectorSetFloat1(F3));
+		const VectorRegister i = vectorFloor(VectorAdd(X, s));
+		const VectorRegister j = vectorFloor(VectorAdd(Y, s));
+		const VectorRegister k = vectorFloor(VectorAdd(Z, s));
+
+		const VectorRegister t = VectorMultiply(VectorAdd(VectorAdd(i, j), k), VectorSetFloat1(G3));
+		const VectorRegister x0 = VectorSubtract(X, VectorSubtract(i, t));
+		const VectorRegister y0 = VectorSubtract(Y, VectorSubtract(j, t));
+		const VectorRegister z0 = VectorSubtract(Z, VectorSubtract(k, t));
+
+		/* Same ranking as the scalar version. x0 >= y0 is the same as !(y0 > x0). */
+		const VectorRegister yGreaterX = greater(y0, x0);
+		const VectorRegister zGreaterX = greater(z0, x0);
+		const VectorRegister zGreaterY = greater(z0, y0);
+		const VectorRegister rankX = VectorSubtract(VectorAdd(one, one), VectorAdd(yGreaterX, zGreaterX));
+		const VectorRegister rankY = VectorAdd(yGreaterX, VectorSubtract(one, zGreaterY));
+		const VectorRegister rankZ = VectorAdd(zGreaterX, zGreaterY);
+
+		const VectorRegister half = VectorSetFloat1(0.5f);
+		const VectorRegister oneAndHalf = VectorSetFloat1(1.5f);
+		const VectorRegister i1 = greater(rankX, oneAndHalf), j1 = greater(rankY, oneAndHalf), k1 = greater(rankZ, oneAndHalf);
+		const VectorRegister i2 = greater(rankX, half), j2 = greater(rankY, half), k2 = greater(rankZ, half);
+
+		const VectorRegister unskew1 = VectorSetFloat1(G3);
+		const VectorRegister unskew2 = VectorSetFloat1(2.0f * G3);
+		const VectorRegister unskew3 = VectorSetFloat1(3.0f * G3);
+
+		const VectorRegister x1 = VectorAdd(VectorSubtract(x0, i1), unskew1);
+		const VectorRegister y1 = VectorAdd(VectorSubtract(y0, j1), unskew1);
+		const VectorRegister z1 = VectorAdd(VectorSubtract(z0, k1), unskew1);
+		const VectorRegister x2 = VectorAdd(VectorSubtract(x0, i2), unskew2);
+		const VectorRegister y2 = VectorAdd(VectorSubtract(y0, j2), unskew2);
+		const VectorRegister z2 = VectorAdd(VectorSubtract(z0, k2), unskew2);
+		const VectorRegister x3 = VectorAdd(VectorSubtract(x0, one), unskew3);
+		const VectorRegister y3 = VectorAdd(VectorSubtract(y0, one), unskew3);
+		const VectorRegister z3 = VectorAdd(VectorSubtract(z0, one), unskew3);
+
+		/* Cell origin and the corner steps as integers. The steps are 0 or 1, so they fit into one int per lane: bit 0-2 for the second, bit 3-5 for the third corner. */
+		MS_ALIGN(16) int32 latticeI[4] GCC_ALIGN(16);
+		MS_ALIGN(16) int32 latticeJ[4] GCC_ALIGN(16);
+		MS_ALIGN(16) int32 latticeK[4] GCC_ALIGN(16);
+		MS_ALIGN(16) int32 steps[4] GCC_ALIGN(16);
+		VectorIntStoreAligned(VectorFloatToInt(i), latticeI);
+		VectorIntStoreAligned(VectorFloatToInt(j), latticeJ);
+		VectorIntStoreAligned(VectorFloatToInt(k), latticeK);
+
+		const VectorRegister packedSteps = VectorAdd(VectorAdd(VectorAdd(i1, VectorMultiply(j1, VectorSetFloat1(2.0f))), VectorMultiply(k1, VectorSetFloat1(4.0f))),
+			VectorMultiply(VectorAdd(VectorAdd(i2, VectorMultiply(j2, VectorSetFloat1(2.0f))), VectorMultiply(k2, VectorSetFloat1(4.0f))), VectorSetFloat1(8.0f)));
+		VectorIntStoreAligned(VectorFloatToInt(packedSteps), steps);
+
+		/* The permutation lookups can't be vectorized, so we gather the four corner gradients lane by lane. Component k of corner c is at c * 3 + k. */
+		MS_ALIGN(16) float q[12][4] GCC_ALIGN(16);
+
+		const uint8* p = tables.Permutation;
+		const FVector* gradients = tables.Gradients3D;
+		for (int32 lane = 0; lane < 4; ++lane)
+		{
+			const int32 ii = latticeI[lane] & BM;
+			const int32 jj = latticeJ[lane] & BM;
+			const int32 kk = latticeK[lane] & BM;
+			const int32 step = steps[lane];
+
+			const int32 corners[4] =
+			{
+				p[ii + p[jj + p[kk]]],
+				p[ii + (step & 1) + p[jj + ((step >> 1) & 1) + p[kk + ((step >> 2) & 1)]]],
+				p[ii + ((step >> 3) & 1) + p[jj + ((step >> 4) & 1) + p[kk + ((step >> 5) & 1)]]],
+				p[ii + 1 + p[jj + 1 + p[kk + 1]]]
+			};
+
+			for (int32 c = 0; c < 4; ++c)
+			{
+				const FVector& gradient = gradients[corners[c]];
+				q[c * 3][lane] = gradient.X;
+				q[c * 3 + 1][lane] = gradient.Y;
+				q[c * 3 + 2][lane] = gradient.Z;
+			}
+		}
+
+		const auto contribution = [&](int32 c, const VectorRegister& x, const VectorRegister& y, const VectorRegister& z) -> VectorRegister
+		{
+			const VectorRegister distanceSquared = VectorAdd(VectorAdd(VectorMultiply(x, x), VectorMultiply(y, y)), VectorMultiply(z, z));
+			const VectorRegister a = VectorMax(VectorSubtract(rSquared, distanceSquared), zero);
+			const VectorRegister aSquared = VectorMultiply(a, a);
+			const VectorRegister xy = VectorAdd(VectorMultiply(x, VectorLoadAligned(q[c * 3])), VectorMultiply(y, VectorLoadAligned(q[c * 3 + 1])));
+			const VectorRegister dot = VectorAdd(xy, VectorMultiply(z, VectorLoadAligned(q[c * 3 + 2])));
+			return VectorMultiply(VectorMultiply(aSquared, aSquared), dot);
+		};
+
+		const VectorRegister n0 = contribution(0, x0, y0, z0);
+		const VectorRegister n1 = contribution(1, x1, y1, z1);
+		const VectorRegister n2 = contribution(2, x2, y2, z2);
+		const VectorRegister n3 = contribution(3, x3, y3, z3);
+
+		return VectorMultiply(VectorAdd(VectorAdd(VectorAdd(n0, n1), n2), n3), VectorSetFloat1(Normalization3D));
+	}
+
+	/** Evaluates 3D simplex noise along a row in X direction, four samples at a time. */
+	struct FSimplex3DRow
+	{
+		FSimplex3DRow(const FPerlinNoiseTables& tables, float Y, float Z) : Tables(tables), RowY(VectorSetFloat1(Y)), RowZ(VectorSetFloat1(Z)) {}
+
+		FORCEINLINE VectorRegister operator()(const VectorRegister& X) const
+		{
+			return Simplex3D4(Tables, X, RowY, RowZ);
+		}
+
+	private:
+		const FPerlinNoiseTables& Tables;
+		VectorRegister RowY, RowZ;
+	};
+};
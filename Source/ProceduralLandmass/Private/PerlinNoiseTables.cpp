@@ -0,0 +1,64 @@
+#include "PerlinNoiseTables.h"
+#include "SharedCache.h"
+
+
+FPerlinNoiseTables::FPerlinNoiseTables(int32 seed)
+{
+	FRandomStream rand(seed);
+
+	/* We still have to draw the 1D gradients of the original algorithm, even if we don't keep them,
+	 * so that the random stream (and with it the permutation) stays the same. */
+	int32 p[B];
+	int i, j, k;
+	for (i = 0; i < B; i++)
+	{
+		p[i] = i;
+
+		rand.FRand(); /* g1 */
+
+		FVector2D g2 = FVector2D::ZeroVector;
+		for (j = 0; j < 2; j++)
+		{
+			g2[j] = (rand.FRand() * 2) - 1;
+			g2.Normalize();
+		}
+		Gradients2D[i] = g2;
+
+		FVector g3 = FVector::ZeroVector;
+		for (j = 0; j < 3; j++)
+		{
+			g3[j] = (rand.FRand() * 2) - 1;
+			g3.Normalize();
+		}
+		Gradients3D[i] = g3;
+	}
+
+	while (--i)
+	{
+		k = p[i];
+		p[i] = p[j = rand.RandRange(0, 255)];
+		p[j] = k;
+	}
+
+	for (i = 0; i < B; i++)
+	{
+		Permutation[i] = (uint8)p[i];
+		Permutation[B + i] = (uint8)p[i];
+	}
+}
+
+TSharedRef<const FPerlinNoiseTables, ESPMode::ThreadSafe> FPerlinNoiseTables::Get(int32 seed)
+{
+	static TSharedCache<int32, FPerlinNoiseTables> cache;
+	return cache.FindOrAdd(seed, [seed]()
+	{
+		/* operator new doesn't respect the cache line alignment, so we allocate the memory ourselves. */
+		void* memory = FMemory::Malloc(sizeof(FPerlinNoiseTables), PLATFORM_CACHE_LINE_SIZE);
+		FPerlinNoiseTables* newTables = new (memory) FPerlinNoiseTables(seed);
+		return TSharedRef<const FPerlinNoiseTables, ESPMode::ThreadSafe>(MakeShareable(newTables, [](FPerlinNoiseTables* oldTables)
+		{
+			oldTables->~FPerlinNoiseTables();
+			FMemory::Free(oldTables);
+		}));
+	});
+}
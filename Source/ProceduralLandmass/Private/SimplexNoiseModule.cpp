@@ -0,0 +1,71 @@
+#include "SimplexNoiseModule.h"
+#include "FractalNoise.h"
+#include "NoiseKernels.h"
+
+
+USimplexNoiseModule::USimplexNoiseModule()
+{
+	Init();
+}
+
+USimplexNoiseModule::USimplexNoiseModule(float noiseScale, int32 seed, float persistence, float lacunarity, int32 octaves) : UNoiseGenerator(noiseScale, seed, persistence, lacunarity, octaves)
+{
+	Init();
+}
+
+void USimplexNoiseModule::Init()
+{
+	FRandomStream rand(Seed);
+
+	InitOctaves(rand);
+
+	/* The tables are generated from where the random stream is now, after the octave offsets. */
+	Tables = FPerlinNoiseTables::Get(rand.GetCurrentSeed());
+}
+
+void USimplexNoiseModule::CopyGenerator_Implementation(const UNoiseGenerator* otherGenerator)
+{
+	Super::CopyGenerator_Implementation(otherGenerator);
+
+	const USimplexNoiseModule* otherModule = Cast<USimplexNoiseModule>(otherGenerator);
+	if (otherModule)
+	{
+		Tables = otherModule->Tables;
+	}
+}
+
+float USimplexNoiseModule::GetNoise2D_Implementation(float X, float Y) const
+{
+	return FFractalNoise::Sample(*this, X, Y, 0.0f, FNoiseOrigin(), &FNoiseKernels::WrapSimplexOrigin, [this](FVector2D vec) { return FNoiseKernels::Simplex(*Tables, vec); });
+}
+
+void USimplexNoiseModule::GetNoise2DLine(float* outValues, int32 numValues, float startX, float startY, float stepX, float stepY, float sampleSpacing,
+	const FNoiseOrigin& origin) const
+{
+	FFractalNoise::SampleLine(*this, outValues, numValues, startX, startY, stepX, stepY, sampleSpacing, origin, &FNoiseKernels::WrapSimplexOrigin,
+		[this](FVector2D vec) { return FNoiseKernels::Simplex(*Tables, vec); },
+		[this](const VectorRegister& X, const VectorRegister& Y) { return FNoiseKernels::Simplex4(*Tables, X, Y); });
+}
+
+bool USimplexNoiseModule::GetNoise2DLineWithDerivatives(float* outValues, float* outDerivativesX, float* outDerivativesY, int32 numValues, 
+	float startX, float startY, float stepX, float stepY, float sampleSpacing, const FNoiseOrigin& origin) const
+{
+	FFractalNoise::SampleLineWithDerivatives(*this, outValues, outDerivativesX, outDerivativesY, numValues, startX, startY, stepX, stepY, sampleSpacing,
+		origin, &FNoiseKernels::WrapSimplexOrigin,
+		[this](const VectorRegister& X, const VectorRegister& Y, VectorRegister& outDerivativeX, VectorRegister& outDerivativeY)
+		{
+			return FNoiseKernels::Simplex4WithDerivatives(*Tables, X, Y, outDerivativeX, outDerivativeY);
+		});
+	return true;
+}
+
+float USimplexNoiseModule::GetNoise3D_Implementation(float X, float Y, float Z) const
+{
+	return FFractalNoise::Sample3D(*this, X, Y, Z, [this](const FVector& vec) { return FNoiseKernels::Simplex3D(*Tables, vec); });
+}
+
+void USimplexNoiseModule::GetNoise3DRow(float* outValues, int32 numValues, float startX, float Y, float Z, float stepX) const
+{
+	FFractalNoise::SampleRow3D(*this, outValues, numValues, startX, Y, Z, stepX,
+		[this](float sampleY, float sampleZ) { return FNoiseKernels::FSimplex3DRow(*Tables, sampleY, sampleZ); });
+}
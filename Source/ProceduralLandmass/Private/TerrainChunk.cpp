@@ -1,5 +1,6 @@
 #include "TerrainChunk.h"
 #include "TerrainGenerator.h"
+#include "TerrainJobScheduler.h"
 #include "Kismet/KismetSystemLibrary.h"
 #include "Components/BoxComponent.h"
 #include "LODInfo.h"
@@ -7,6 +8,7 @@
 
 FVector UTerrainChunk::CameraLocation = FVector::ZeroVector;
 FVector UTerrainChunk::LastCameraLocation = FVector::ZeroVector;
+FVector UTerrainChunk::CameraDirection = FVector::ZeroVector;
 
 
 UTerrainChunk::~UTerrainChunk()
@@ -19,9 +21,6 @@ UTerrainChunk::~UTerrainChunk()
 			meshData = nullptr;
 		}
 	}
-
-	delete HeightMap;
-	HeightMap = nullptr;
 }
 
 void UTerrainChunk::InitChunk(ATerrainGenerator* parentTerrainGenerator, TArray<FLODInfo>* lodInfoArray)
@@ -31,7 +30,6 @@ void UTerrainChunk::InitChunk(ATerrainGenerator* parentTerrainGenerator, TArray<
 
 	const int32 maxLOD = DetailLevels->Last().LOD;
 	LODMeshes.SetNum(maxLOD + 1);
-	RequestedMeshData.SetNum(maxLOD + 1);
 	AttachToComponent(TerrainGenerator->GetRootComponent(), FAttachmentTransformRules::SnapToTargetIncludingScale);
 	
 	TotalChunkSize = TerrainGenerator->Configuration.GetChunkSize() * parentTerrainGenerator->Configuration.MapScale;
@@ -54,17 +52,28 @@ void UTerrainChunk::UpdateChunk(FVector cameraLocation)
 	const float distanceToCamera = FMath::Sqrt(Box.ComputeSquaredDistanceToPoint(cameraLocation));
 
 	const int32 newLOD = FLODInfo::FindLOD(*DetailLevels, distanceToCamera);
+	if (newLOD == PendingLOD)
+	{
+		return;
+	}
+
+	/* Whatever LOD we were waiting for, we don't need it anymore. The job for it is dropped, wherever it is. */
+	if (PendingLOD != INDEX_NONE)
+	{
+		PendingLOD = INDEX_NONE;
+		JobGeneration.Increment();
+	}
+
 	if (newLOD == CurrentLOD)
 	{
 		return;
 	}
 
-	/* Request a mesh data for the new LOD if we don't have one and didn't already requested one. */
-	if (LODMeshes[newLOD] == nullptr && RequestedMeshData[newLOD] == false)
+	/* Request a mesh data for the new LOD if we don't have one. */
+	if (LODMeshes[newLOD] == nullptr)
 	{
-		RequestedMeshData[newLOD] = true;
-		const FVector2D relativePosition = FVector2D(GetRelativeTransform().GetLocation());
-		TerrainGenerator->CreateAndEnqueueMeshDataJob(this, newLOD, false, relativePosition);
+		PendingLOD = newLOD;
+		TerrainGenerator->CreateAndEnqueueMeshDataJob(this, newLOD, false);
 		return;
 	}
 
@@ -82,14 +91,39 @@ int32 UTerrainChunk::GetOptimalLOD(FVector cameraLocation)
 	return FLODInfo::FindLOD(*DetailLevels, distanceToCamera);
 }
 
+int32 UTerrainChunk::GetJobPriority() const
+{
+	const float distanceToCamera = FMath::Sqrt(Box.ComputeSquaredDistanceToPoint(CameraLocation));
+
+	/* 1 for chunks straight ahead, 2 for chunks straight behind. Top down cameras don't prefer any direction. */
+	const FVector viewDirection = CameraDirection.GetSafeNormal2D();
+	const FVector directionToChunk = (GetComponentLocation() - CameraLocation).GetSafeNormal2D();
+	const float viewFactor = viewDirection.IsZero() ? 1.0f : 1.5f - 0.5f * FVector::DotProduct(viewDirection, directionToChunk);
+
+	const int32 ring = FMath::FloorToInt(distanceToCamera * viewFactor / FMath::Max(TotalChunkSize, 1));
+	return FMath::Clamp(ring, 0, FTerrainJobScheduler::NumPriorities - 1);
+}
+
+float UTerrainChunk::GetHeightMapValue(int32 x, int32 y) const
+{
+	if (HeightMap.IsValid())
+	{
+		return HeightMap->GetValue(HeightMapApron + x / HeightMapStride, HeightMapApron + y / HeightMapStride);
+	}
+	return QuantizedHeightMap.IsValid() ? QuantizedHeightMap->GetValue(HeightMapApron + x / HeightMapStride, HeightMapApron + y / HeightMapStride) : 0.0f;
+}
+
 void UTerrainChunk::SetNewLOD(int32 newLOD)
 {
+	if (newLOD == PendingLOD)
+	{
+		PendingLOD = INDEX_NONE;
+	}
+
 	if (newLOD == CurrentLOD || LODMeshes[newLOD] == nullptr)
 	{
 		return;
 	}
-	
-	RequestedMeshData[newLOD] = true;
 
 	SetMeshSectionVisible(CurrentLOD, false);
 	SetMeshSectionVisible(newLOD, true);
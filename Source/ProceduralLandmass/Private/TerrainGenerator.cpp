@@ -9,6 +9,7 @@
 #include "Kismet/KismetSystemLibrary.h"
 #include "Public/UnityLibrary.h"
 #include "TerrainGeneratorWorker.h"
+#include "TerrainJobScheduler.h"
 #include "TimerManager.h"
 #include "GameFramework/PlayerController.h"
 #include "Public/TerrainChunk.h"
@@ -73,6 +74,16 @@ void ATerrainGenerator::OnConstruction(const FTransform& Transform)
 		bClearTerrain = false;
 		ClearTerrain();
 	}
+	else if (bBenchmarkNormals)
+	{
+		bBenchmarkNormals = false;
+		BenchmarkNormals();
+	}
+	else if (bBenchmarkNoise3D)
+	{
+		bBenchmarkNoise3D = false;
+		BenchmarkNoise3D();
+	}
 	else if (bUpdateTerrain || bAutoUpdate)
 	{
 		bUpdateTerrain = false;
@@ -85,6 +96,7 @@ void ATerrainGenerator::UpdateChunkLOD()
 {
 	UTerrainChunk::LastCameraLocation = UTerrainChunk::CameraLocation;
 	UTerrainChunk::CameraLocation = UUnityLibrary::GetCameraLocation(this);
+	UTerrainChunk::CameraDirection = UUnityLibrary::GetCameraDirection(this);
 
 	const float distanceMoved = FVector::Dist(UTerrainChunk::LastCameraLocation, UTerrainChunk::CameraLocation);
 
@@ -100,6 +112,31 @@ void ATerrainGenerator::UpdateChunkLOD()
 			}
 		}
 	}
+
+	UpdateJobPriorities();
+}
+
+void ATerrainGenerator::UpdateJobPriorities()
+{
+	if (!JobScheduler.IsValid())
+	{
+		return;
+	}
+
+	const float chunkWorldSize = Configuration.GetChunkSize() * Configuration.MapScale;
+	const bool bMoved = FVector::DistSquared(PrioritizedCameraLocation, UTerrainChunk::CameraLocation) > FMath::Square(chunkWorldSize / 2.0f);
+	const bool bTurned = FVector::DotProduct(PrioritizedCameraDirection, UTerrainChunk::CameraDirection) < 0.95f;
+	if (!bMoved && !(bTurned && !UTerrainChunk::CameraDirection.IsZero()))
+	{
+		return;
+	}
+
+	PrioritizedCameraLocation = UTerrainChunk::CameraLocation;
+	PrioritizedCameraDirection = UTerrainChunk::CameraDirection;
+	JobScheduler->Reprioritize([](const FMeshDataJob& job)
+	{
+		return job.Chunk ? job.Chunk->GetJobPriority() : FTerrainJobScheduler::NumPriorities - 1;
+	});
 }
 
 /////////////////////////////////////////////////////
@@ -107,6 +144,13 @@ void ATerrainGenerator::ClearTerrain()
 {
 	ClearTimers();
 	ClearThreads();
+
+	/* Finished jobs that weren't applied yet. Their height maps go with them. */
+	for (FMeshDataJob& job : FinishedJobsToApply)
+	{
+		job.DeleteGeneratedMeshData();
+	}
+	FinishedJobsToApply.Empty();
 			
 	/* Clear all chunks. */
 	for (auto& chunk : Chunks)
@@ -124,8 +168,102 @@ void ATerrainGenerator::ClearTerrain()
 	TimeStampStartGeneratingTerrain = 0.0f;
 }
 
+void ATerrainGenerator::BenchmarkNormals()
+{
+	const int32 numIterations = 50;
+	const int32 heightMapApron = 1;
+	const ENumVertices chunkSizes[] = { ENumVertices::x61, ENumVertices::x121, ENumVertices::x241 };
+	for (const ENumVertices chunkSize : chunkSizes)
+	{
+		const int32 numVertices = (int32)chunkSize;
+		FArray2D heightMap(numVertices + 2 * heightMapApron, numVertices + 2 * heightMapApron);
+		UUnityLibrary::PerlinNoiseGrid(heightMap, FVector2D(0.5f, 0.5f), 1.0f / 32.0f);
+
+		FTerrainMeshData meshData(heightMap, heightMapApron, 1, Configuration.Amplitude, 0, Configuration.HeightCurveTable.Get(), Configuration.MapScale);
+
+		double startTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < numIterations; i++)
+		{
+			meshData.CalculateFaceNormals(heightMap, heightMapApron, 1, Configuration.Amplitude, Configuration.HeightCurveTable.Get());
+		}
+		const double faceNormalsTime = (FPlatformTime::Seconds() - startTime) * 1000.0 / numIterations;
+
+		startTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < numIterations; i++)
+		{
+			meshData.CalculateNormalsFromCentralDifferences(heightMap, heightMapApron, 1, Configuration.Amplitude, Configuration.HeightCurveTable.Get());
+		}
+		const double centralDifferencesTime = (FPlatformTime::Seconds() - startTime) * 1000.0 / numIterations;
+
+		const FString text = FString::Printf(TEXT("Normals for %dx%d vertices: face normals %.3f ms, central differences %.3f ms (%.1fx faster)"), 
+			numVertices, numVertices, faceNormalsTime, centralDifferencesTime, faceNormalsTime / FMath::Max(centralDifferencesTime, 0.001));
+		UE_LOG(LogTemp, Log, TEXT("%s"), *text);
+		UKismetSystemLibrary::PrintString(this, text, true, true, FLinearColor::Green, 10.0f);
+	}
+}
+
+void ATerrainGenerator::BenchmarkNoise3D()
+{
+	const UNoiseGenerator* noiseGenerator = Configuration.NoiseGenerator;
+	if (!IsValid(noiseGenerator))
+	{
+		noiseGenerator = Configuration.NoiseGeneratorClass ? NewObject<UNoiseGenerator>((UObject*)GetTransientPackage(), Configuration.NoiseGeneratorClass) : nullptr;
+	}
+	if (!IsValid(noiseGenerator))
+	{
+		UE_LOG(LogTemp, Error, TEXT("No noise generator to benchmark."));
+		return;
+	}
+
+	const int32 numIterations = 5;
+	const int32 brickSizes[] = { 16, 32, 64 };
+	for (const int32 brickSize : brickSizes)
+	{
+		const FIntVector size(brickSize, brickSize, brickSize);
+		const int32 numSamples = size.X * size.Y * size.Z;
+		TArray<float> values; values.SetNumUninitialized(numSamples);
+
+		double startTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < numIterations; i++)
+		{
+			noiseGenerator->GetNoise3DBrick(values.GetData(), size, FVector(i * brickSize, 0.0f, 0.0f));
+		}
+		const double brickTime = FPlatformTime::Seconds() - startTime;
+
+		startTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < numIterations; i++)
+		{
+			for (int32 z = 0; z < size.Z; ++z)
+			{
+				for (int32 y = 0; y < size.Y; ++y)
+				{
+					for (int32 x = 0; x < size.X; ++x)
+					{
+						values[x + (y + z * size.Y) * size.X] = noiseGenerator->GetNoise3D(i * brickSize + x, y, z);
+					}
+				}
+			}
+		}
+		const double perSampleTime = FPlatformTime::Seconds() - startTime;
+
+		const double brickSamplesPerSecond = numSamples * numIterations / FMath::Max(brickTime, 0.000001);
+		const double perSampleSamplesPerSecond = numSamples * numIterations / FMath::Max(perSampleTime, 0.000001);
+		const FString text = FString::Printf(TEXT("3D noise %d^3 brick: %.2f M samples/s, per sample: %.2f M samples/s (%.1fx faster)"), 
+			brickSize, brickSamplesPerSecond / 1000000.0, perSampleSamplesPerSecond / 1000000.0, brickSamplesPerSecond / perSampleSamplesPerSecond);
+		UE_LOG(LogTemp, Log, TEXT("%s"), *text);
+		UKismetSystemLibrary::PrintString(this, text, true, true, FLinearColor::Green, 10.0f);
+	}
+}
+
 void ATerrainGenerator::ClearThreads()
 {
+	/* Jobs that weren't started yet are dropped, the chunks they are for are about to be destroyed. */
+	if (JobScheduler.IsValid())
+	{
+		JobScheduler->ClearJobs();
+		JobScheduler.Reset();
+	}
+
 	for (int32 i = 0; i < WorkerThreads.Num(); i++)
 	{
 		if (WorkerThreads[i])
@@ -152,29 +290,42 @@ void ATerrainGenerator::GenerateTerrain()
 	
 	SetActorScale3D(FVector(Configuration.MapScale));
 	Configuration.InitLODs();
+	Configuration.BakeHeightCurve();
+	Configuration.HashNoiseParameters();
 	if (Configuration.NoiseGeneratorClass)
 	{
 		Configuration.NoiseGenerator = NewObject<UNoiseGenerator>((UObject*)GetTransientPackage(), Configuration.NoiseGeneratorClass);
 	}
+	PublishConfiguration();
+	TerrainVersion = ConfigurationVersion;
 	
 	const int32 numThreads = Configuration.GetNumberOfThreads();
 	const int32 chunksPerDirection = Configuration.NumChunks;	
 	const int32 chunkSize = Configuration.GetChunkSize();
 		
 	/* Create worker threads. */	
+	JobScheduler = MakeShared<FTerrainJobScheduler, ESPMode::ThreadSafe>(numThreads);
 	WorkerThreads.SetNum(numThreads);
 	for (int32 i = 0; i < numThreads; i++)
 	{
-		WorkerThreads[i] = new FTerrainGeneratorWorker(Configuration);
+		WorkerThreads[i] = new FTerrainGeneratorWorker(JobScheduler.ToSharedRef(), i);
 	}	
 		
 	/* The top positions for chunks. These are the chunk's relative positions to the terrain generator actor,
 	 * measured from their centers. */
 	const float topLeftChunkPositionX = ((chunksPerDirection - 1) * chunkSize) / -2.0f;
 	const float topLeftChunkPositionY = ((chunksPerDirection - 1) * chunkSize) / -2.0f;
+
+	/* The same in noise space, in double precision. The chunk positions above lose precision with large numbers of chunks. */
+	const double topLeftNoiseOriginX = ((chunksPerDirection - 1) * (double)chunkSize) / -2.0;
+	const double topLeftNoiseOriginY = ((chunksPerDirection - 1) * (double)chunkSize) / -2.0;
 	
-	/* Create mesh data jobs and add them to the worker threads. */
+	/* Create mesh data jobs and add them to the worker threads. The jobs are prioritized for the current camera. */
 	const FVector cameraLocation = UUnityLibrary::GetCameraLocation(this);
+	UTerrainChunk::CameraLocation = cameraLocation;
+	UTerrainChunk::CameraDirection = UUnityLibrary::GetCameraDirection(this);
+	PrioritizedCameraLocation = UTerrainChunk::CameraLocation;
+	PrioritizedCameraDirection = UTerrainChunk::CameraDirection;
 	int32 i = 0;
 	for (int32 y = 0; y < chunksPerDirection; ++y)
 	{
@@ -182,11 +333,11 @@ void ATerrainGenerator::GenerateTerrain()
 		{
 			/* Chunk position is relative to the whole terrain actor. */
 			const FVector chunkPosition = FVector(topLeftChunkPositionX + (x * chunkSize), topLeftChunkPositionY + (y * chunkSize), 0.0f);
-			const FVector2D noiseOffset = FVector2D(chunkPosition);
 
 			const FName chunkName = *FString::Printf(TEXT("Terrain chunk %d"), i);
 			UTerrainChunk* newChunk = NewObject<UTerrainChunk>(this, chunkName);
 			newChunk->InitChunk(this, &Configuration.LODs);
+			newChunk->NoiseOrigin = FNoiseOrigin(topLeftNoiseOriginX + x * (double)chunkSize, topLeftNoiseOriginY + y * (double)chunkSize);
 			newChunk->bEnableAutoLODGeneration = true;
 			newChunk->bUseAsyncCooking = true;
 			newChunk->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
@@ -197,7 +348,7 @@ void ATerrainGenerator::GenerateTerrain()
 			Chunks.Add(FVector2D(chunkPosition), newChunk);
 
 			const int32 levelOfDetail = newChunk->GetOptimalLOD(cameraLocation);			
-			CreateAndEnqueueMeshDataJob(newChunk, levelOfDetail, false, noiseOffset);
+			CreateAndEnqueueMeshDataJob(newChunk, levelOfDetail, false);
 			newChunk->Status = EChunkStatus::MESH_DATA_REQUESTED;
 			++i;
 		}
@@ -213,25 +364,30 @@ void ATerrainGenerator::GenerateTerrain()
 	
 void ATerrainGenerator::UpdateTerrain()
 {
+	Configuration.BakeHeightCurve();
+	Configuration.HashNoiseParameters();
 	if (Configuration == OldConfiguration)
 	{
 		return;
 	}
 		
-	if (Configuration.NumChunks != OldConfiguration.NumChunks)
+	if (!Configuration.HasSameMeshLayout(OldConfiguration))
 	{
 		GenerateTerrain();
 		return;
 	}
+
+	/* When only amplitude or height curve changed, the cached height maps can be used as they are. Otherwise the noise generator
+	 * is created again, with the new parameters of its class. */
+	const bool bRegenerateHeightMaps = !Configuration.GeneratesSameHeightMaps(OldConfiguration);
 	
-	/* Update the configurations for all worker threads. */
-	for (FTerrainGeneratorWorker* worker : WorkerThreads)
+	if (bRegenerateHeightMaps)
 	{
-		if (worker)
-		{
-			worker->UpdateConfiguration(Configuration);
-		}
+		Configuration.NoiseGenerator = Configuration.NoiseGeneratorClass ? NewObject<UNoiseGenerator>((UObject*)GetTransientPackage(), Configuration.NoiseGeneratorClass) : nullptr;
 	}
+
+	/* Jobs that are already queued keep the configuration they were created with, their results are thrown away. */
+	PublishConfiguration();
 	
 	const int32 chunksPerDirection = Configuration.NumChunks;
 	const int32 chunkSize = Configuration.GetChunkSize();
@@ -257,14 +413,11 @@ void ATerrainGenerator::UpdateTerrain()
 
 			UTerrainChunk* chunk = *chunkPointer;
 
-			/* Update all LOD meshes. */
-			for (int32 lod = 0; lod < chunk->LODMeshes.Num(); ++lod)
+			/* One job updates the heights of all LOD meshes of the chunk. It's enqueued for the finest one. */
+			const int32 finestLOD = chunk->LODMeshes.IndexOfByPredicate([](const FTerrainMeshData* data) { return data != nullptr; });
+			if (finestLOD != INDEX_NONE)
 			{
-				const FTerrainMeshData* data = chunk->LODMeshes[lod];
-				if (data)
-				{
-					CreateAndEnqueueMeshDataJob(chunk, lod, true, chunkPosition);
-				}
+				CreateAndEnqueueMeshDataJob(chunk, finestLOD, true, bRegenerateHeightMaps);
 			}
 			++i;
 		}
@@ -274,14 +427,35 @@ void ATerrainGenerator::UpdateTerrain()
 }
 
 /////////////////////////////////////////////////////
-void ATerrainGenerator::CreateAndEnqueueMeshDataJob(UTerrainChunk* chunk, int32 levelOfDetail, bool bUpdateMeshSection /*= false*/, const FVector2D& noiseOffset /*= FVector2D::ZeroVector*/)
+void ATerrainGenerator::CreateAndEnqueueMeshDataJob(UTerrainChunk* chunk, int32 levelOfDetail, bool bUpdateMeshSection /*= false*/, bool bRegenerateHeightMap /*= true*/)
 {
-	static int32 i = 0;
+	if (!JobScheduler.IsValid() || !ConfigurationSnapshot.IsValid())
+	{
+		UE_LOG(LogTemp, Error, TEXT("Can't create a mesh data job, the terrain wasn't generated yet."));
+		return;
+	}
+
 	NumJobsRemaining++;
-	FMeshDataJob newJob = FMeshDataJob(chunk, &FinishedMeshDataJobs, levelOfDetail, bUpdateMeshSection, noiseOffset);
-	FTerrainGeneratorWorker* worker = WorkerThreads[i++ % Configuration.GetNumberOfThreads()];
-	levelOfDetail == 0 ? worker->PriorityJobs.Enqueue(newJob) : worker->PendingJobs.Enqueue(newJob);
-	worker->UnPause();
+	FMeshDataJob newJob = FMeshDataJob(chunk, &FinishedMeshDataJobs, levelOfDetail, bUpdateMeshSection, chunk->NoiseOrigin);
+	newJob.bRegenerateHeightMap = bRegenerateHeightMap;
+	newJob.Generation = bUpdateMeshSection ? INDEX_NONE : chunk->GetJobGeneration();
+	newJob.Snapshot = ConfigurationSnapshot;
+	for (int32 lod = 0; lod < chunk->LODMeshes.Num() && bUpdateMeshSection; ++lod)
+	{
+		if (chunk->LODMeshes[lod])
+		{
+			newJob.UpdatedLODs.Add(lod);
+		}
+	}
+	newJob.SourceHeightMap = chunk->HeightMap;
+	newJob.SourceQuantizedHeightMap = chunk->QuantizedHeightMap;
+	newJob.SourceHeightMapDerivatives = chunk->HeightMapDerivatives;
+	newJob.SourceQuantizedHeightMapDerivatives = chunk->QuantizedHeightMapDerivatives;
+	newJob.SourceHeightMapSampleSpacing = chunk->HeightMapSampleSpacing;
+	newJob.SourceHeightMapApron = chunk->HeightMapApron;
+	newJob.SourceHeightMapStride = chunk->HeightMapStride;
+	newJob.SourceHeightMapVersion = chunk->HeightMapVersion;
+	JobScheduler->Submit(newJob, chunk->GetJobPriority());
 }
 	
 /////////////////////////////////////////////////////
@@ -290,37 +464,172 @@ void ATerrainGenerator::HandleFinishedMeshDataJobs()
 	FMeshDataJob job;
 	while (FinishedMeshDataJobs.Dequeue(job))
 	{
-		FTerrainMeshData* meshData = job.GeneratedMeshData;
-		UTerrainChunk* chunk = job.Chunk;
-		const int32 lod = meshData->LOD;
-	
-		if (job.bUpdateMeshSection)
+		/* The chunks of a cleared terrain are gone. The job's height map goes with it. */
+		if (job.Snapshot->Version < TerrainVersion)
 		{
-			chunk->UpdateMeshSection(lod, meshData->Vertices, meshData->Normals, meshData->UVs, meshData->VertexColors, meshData->Tangents);
+			job.DeleteGeneratedMeshData();
+			continue;
 		}
-		else
+		FinishedJobsToApply.Add(job);
+	}
+
+	/* The chunks closest to and in front of the camera first. Jobs of the same priority keep their order.
+	 * The priorities are calculated once per job and frame, not for every comparison. */
+	for (FMeshDataJob& finishedJob : FinishedJobsToApply)
+	{
+		finishedJob.ApplyPriority = finishedJob.Chunk->GetJobPriority();
+	}
+	FinishedJobsToApply.StableSort([](const FMeshDataJob& jobA, const FMeshDataJob& jobB)
+	{
+		return jobA.ApplyPriority < jobB.ApplyPriority;
+	});
+
+	/* Apply as many jobs as the budget allows, but at least one per frame. The rest waits for the next frame. */
+	const double startTime = FPlatformTime::Seconds();
+	int32 numAppliedJobs = 0;
+	int32 numAppliedVertices = 0;
+	while (numAppliedJobs < FinishedJobsToApply.Num())
+	{
+		if (numAppliedJobs > 0)
 		{
-			chunk->CreateMeshSection(lod, meshData->Vertices, meshData->Triangles, meshData->Normals, meshData->UVs, meshData->VertexColors, meshData->Tangents, false);
-			chunk->LODMeshes[lod] = meshData;
-			chunk->HeightMap = job.GeneratedHeightMap;
+			const bool bOutOfTime = MeshApplyTimeBudget > 0.0f && (FPlatformTime::Seconds() - startTime) * 1000.0 >= MeshApplyTimeBudget;
+			const bool bOutOfVertices = MeshApplyVertexBudget > 0 && numAppliedVertices >= MeshApplyVertexBudget;
+			if (bOutOfTime || bOutOfVertices)
+			{
+				break;
+			}
 		}
+		numAppliedVertices += ApplyFinishedMeshDataJob(FinishedJobsToApply[numAppliedJobs++]);
+	}
+	FinishedJobsToApply.RemoveAt(0, numAppliedJobs, false);
+	
+	ReleaseUnusedSnapshots();
+
+	if(bShowJobsRemaining && NumJobsRemaining > 0)
+	{
+		FString text = FString::Printf(TEXT("%d jobs remaining."), NumJobsRemaining);
+		UKismetSystemLibrary::PrintString(this, text, true, false, FLinearColor::Yellow, 0.0f);
+	}
+}
+
+int32 ATerrainGenerator::ApplyFinishedMeshDataJob(FMeshDataJob& job)
+{
+	int32 numUploadedVertices = 0;
+	FTerrainMeshData* meshData = job.GeneratedMeshData;
+	UTerrainChunk* chunk = job.Chunk;
+	const int32 lod = job.LevelOfDetail;
+	/* A result is outdated if the configuration changed since, or if its mesh was built from a height map of other noise than the current one. */
+	const bool bCurrentHeightMap = job.HeightMapVersion == ConfigurationSnapshot->HeightMapVersion;
+	const bool bOutdated = job.Snapshot->Version != ConfigurationVersion || !bCurrentHeightMap;
 	
+	/* Jobs that were superseded by a newer LOD request are dropped before anything is uploaded. The worker may have stopped before
+	 * it generated the mesh data. */
+	const bool bSuperseded = !job.bUpdateMeshSection && (meshData == nullptr || job.IsSuperseded());
+	if (bSuperseded)
+	{
+		job.DeleteGeneratedMeshData();
+		meshData = nullptr;
+	}
+	else if (job.bUpdateMeshSection)
+	{
+		/* Only the heights changed, so the UVs are left as they are. If the configuration changed again since, 
+		 * the update job for that is queued as well and the results are just dropped. */
+		const TArray<FVector2D> unchangedUVs;
+		TArray<FVector> unpackedNormals;
+		for (int32 i = 0; i < job.UpdatedMeshData.Num() && !bOutdated; ++i)
+		{
+			const int32 sectionLOD = job.UpdatedLODs[i];
+			FTerrainMeshData* sectionMeshData = chunk->LODMeshes[sectionLOD];
+			if (sectionMeshData && job.UpdatedMeshData[i] && sectionMeshData->TakeHeightsFrom(*job.UpdatedMeshData[i]))
+			{
+				chunk->UpdateMeshSection(sectionLOD, sectionMeshData->Vertices, sectionMeshData->GetNormals(unpackedNormals), unchangedUVs, sectionMeshData->VertexColors, sectionMeshData->Tangents);
+				numUploadedVertices += sectionMeshData->Vertices.Num();
+			}
+		}
+		job.DeleteGeneratedMeshData();
+	}
+	else
+	{
+		TArray<FVector> unpackedNormals;
+		chunk->CreateMeshSection(lod, meshData->Vertices, meshData->GetTriangles(), meshData->GetNormals(unpackedNormals), meshData->UVs, meshData->VertexColors, meshData->Tangents, false);
+		chunk->LODMeshes[lod] = meshData;
+		numUploadedVertices += meshData->Vertices.Num();
+	}
+
+	/* A newly generated height map of the current noise replaces the chunk's one, even from superseded jobs. Unless another job replaced
+	 * it with a current one since this one was created, then this job's height map is dropped. Jobs still reading the old one keep it alive. */
+	const bool bHeightMapUnchanged = chunk->HeightMap == job.SourceHeightMap && chunk->QuantizedHeightMap == job.SourceQuantizedHeightMap;
+	const bool bChunkHeightMapCurrent = chunk->HasHeightMap() && chunk->HeightMapVersion == ConfigurationSnapshot->HeightMapVersion;
+	const bool bGeneratedHeightMap = job.GeneratedHeightMap.IsValid() || job.GeneratedQuantizedHeightMap.IsValid();
+	if (bGeneratedHeightMap && bCurrentHeightMap && (bHeightMapUnchanged || !bChunkHeightMapCurrent))
+	{
+		chunk->HeightMap = job.GeneratedHeightMap;
+		chunk->QuantizedHeightMap = job.GeneratedQuantizedHeightMap;
+		chunk->HeightMapDerivatives = job.GeneratedHeightMapDerivatives;
+		chunk->QuantizedHeightMapDerivatives = job.GeneratedQuantizedHeightMapDerivatives;
+		chunk->HeightMapSampleSpacing = job.HeightMapSampleSpacing;
+		chunk->HeightMapApron = job.HeightMapApron;
+		chunk->HeightMapStride = job.HeightMapStride;
+		chunk->HeightMapVersion = job.HeightMapVersion;
+	}
+
+	if (!bSuperseded)
+	{
 		chunk->SetMaterial(lod, TerrainMaterial);
-		chunk->SetNewLOD(lod);
-		chunk->Status = EChunkStatus::IDLE;
-		
-		if(--NumJobsRemaining == 0 && !bFirstGenerationDone)
+		if (!job.bUpdateMeshSection)
 		{
-			bFirstGenerationDone = true;
-			float timeForHandlingMeshDataJobs = GetWorld()->GetTimeSeconds() - TimeStampStartGeneratingTerrain;
-			FString text = FString::Printf(TEXT("Time for generating terrain: %.2f seconds"), timeForHandlingMeshDataJobs);
-			UKismetSystemLibrary::PrintString(this, text, true, true, FLinearColor::Green, 5.0f);
+			chunk->SetNewLOD(lod);
 		}
+		chunk->Status = EChunkStatus::IDLE;
+	}
+
+	/* A new mesh built with an older configuration or from older noise gets its heights updated. */
+	if (!bSuperseded && !job.bUpdateMeshSection && bOutdated)
+	{
+		CreateAndEnqueueMeshDataJob(chunk, lod, true, !bCurrentHeightMap);
 	}
 	
-	if(NumJobsRemaining > 0)
+	if(--NumJobsRemaining == 0 && !bFirstGenerationDone)
 	{
-		FString text = FString::Printf(TEXT("%d jobs remaining."), NumJobsRemaining);
-		UKismetSystemLibrary::PrintString(this, text, true, false, FLinearColor::Yellow, 0.0f);
+		bFirstGenerationDone = true;
+		float timeForHandlingMeshDataJobs = GetWorld()->GetTimeSeconds() - TimeStampStartGeneratingTerrain;
+		FString text = FString::Printf(TEXT("Time for generating terrain: %.2f seconds (%d jobs stolen by idle workers)"), timeForHandlingMeshDataJobs, 
+			JobScheduler.IsValid() ? JobScheduler->GetNumStolenJobs() : 0);
+		UKismetSystemLibrary::PrintString(this, text, true, true, FLinearColor::Green, 5.0f);
+	}
+
+	return numUploadedVertices;
+}
+
+/////////////////////////////////////////////////////
+void ATerrainGenerator::PublishConfiguration()
+{
+	/* The snapshot copies the noise generator, so nothing that happens to ours afterwards reaches the worker threads. */
+	++ConfigurationVersion;
+	const bool bSameHeightMaps = ConfigurationSnapshot.IsValid() && Configuration.GeneratesSameHeightMaps(ConfigurationSnapshot->Configuration);
+	const int32 heightMapVersion = bSameHeightMaps ? ConfigurationSnapshot->HeightMapVersion : ConfigurationVersion;
+	ConfigurationSnapshot = MakeShared<const FTerrainConfigurationSnapshot, ESPMode::ThreadSafe>(Configuration, ConfigurationVersion, heightMapVersion);
+	PublishedSnapshots.Add(ConfigurationSnapshot);
+	ReleaseUnusedSnapshots();
+}
+
+void ATerrainGenerator::ReleaseUnusedSnapshots()
+{
+	/* Only the game thread hands out snapshots, so one that only we reference stays that way. */
+	PublishedSnapshots.RemoveAll([](const TSharedPtr<const FTerrainConfigurationSnapshot, ESPMode::ThreadSafe>& snapshot)
+	{
+		return snapshot.IsUnique();
+	});
+}
+
+void ATerrainGenerator::AddReferencedObjects(UObject* inThis, FReferenceCollector& collector)
+{
+	ATerrainGenerator* terrainGenerator = CastChecked<ATerrainGenerator>(inThis);
+	for (const TSharedPtr<const FTerrainConfigurationSnapshot, ESPMode::ThreadSafe>& snapshot : terrainGenerator->PublishedSnapshots)
+	{
+		UObject* noiseGenerator = snapshot->Configuration.NoiseGenerator;
+		collector.AddReferencedObject(noiseGenerator, terrainGenerator);
 	}
+
+	Super::AddReferencedObjects(inThis, collector);
 }
@@ -1,6 +1,7 @@
 // Fill out your copyright notice in the Description page of Project Settings.
 
 #include "TerrainGeneratorWorker.h"
+#include "TerrainJobScheduler.h"
 #include "HAL/RunnableThread.h"
 #include "TerrainGenerator.h"
 #include "Kismet/KismetSystemLibrary.h"
@@ -11,12 +12,10 @@ int32 FTerrainGeneratorWorker::ThreadCounter = 0;
 
 
 //////////////////////////////////////////////////////
-FTerrainGeneratorWorker::FTerrainGeneratorWorker(const FTerrainConfiguration& configuration)
+FTerrainGeneratorWorker::FTerrainGeneratorWorker(const TSharedRef<FTerrainJobScheduler, ESPMode::ThreadSafe>& scheduler, int32 workerIndex) :
+	Scheduler(scheduler),
+	WorkerIndex(workerIndex)
 {
-	Configuration = FTerrainConfiguration(configuration);
-
-	Semaphore = FGenericPlatformProcess::GetSynchEventFromPool(false);
-
 	bWorkFinished = false;
 
 	ThreadName = TEXT("Terrain Generator Worker Thread #") + FString::FromInt(GetNewThreadNumber());
@@ -25,7 +24,6 @@ FTerrainGeneratorWorker::FTerrainGeneratorWorker(const FTerrainConfiguration& co
 
 FTerrainGeneratorWorker::~FTerrainGeneratorWorker()
 {
-	ClearJobQueue();
 	delete Thread;
 }
 
@@ -35,14 +33,14 @@ uint32 FTerrainGeneratorWorker::Run()
 	while(!bWorkFinished)
 	{
 		FMeshDataJob currentJob;
-		while (!bWorkFinished && !bPause && (PriorityJobs.Dequeue(currentJob) || PendingJobs.Dequeue(currentJob)))
+		while (!bWorkFinished && !bPause && Scheduler->GetNextJob(WorkerIndex, currentJob))
 		{
 			DoWork(currentJob);
 		}
 
 		if(!bWorkFinished)
 		{
-			Semaphore->Wait();
+			Scheduler->WaitForJob(WorkerIndex, !bPause);
 		}
 	}
 
@@ -52,108 +50,207 @@ uint32 FTerrainGeneratorWorker::Run()
 void FTerrainGeneratorWorker::Stop()
 {
 	bWorkFinished = true;
+	Scheduler->WakeUp(WorkerIndex);
+}
+
+void FTerrainGeneratorWorker::UnPause()
+{
+	bPause = false;
+	Scheduler->WakeUp(WorkerIndex);
 }
 
 //////////////////////////////////////////////////////
 void FTerrainGeneratorWorker::DoWork(FMeshDataJob& currentJob)
 {
-	const UTerrainChunk* chunk = currentJob.Chunk;
+	/* Superseded jobs are handed back without any data, so the game thread can count them as done. */
+	if (currentJob.IsSuperseded())
+	{
+		currentJob.DropOffQueue->Enqueue(currentJob);
+		return;
+	}
+
+	/* The configuration the job was created with. It's immutable, so it can't change while we work. */
+	const FTerrainConfiguration& configuration = currentJob.Snapshot->Configuration;
 	const int32 levelOfDetail = currentJob.LevelOfDetail;
 	const bool bUpdateSection = currentJob.bUpdateMeshSection;
-	if (bUpdateSection && chunk->LODMeshes[levelOfDetail] == nullptr)
+	if (bUpdateSection && currentJob.UpdatedLODs.Num() == 0)
 	{
-		UE_LOG(LogTemp, Warning, TEXT("No mesh for requested LOD %d!"), levelOfDetail);
+		UE_LOG(LogTemp, Warning, TEXT("No meshes to update for LOD %d!"), levelOfDetail);
+		currentJob.DropOffQueue->Enqueue(currentJob);
 		return;
 	}
 
-	const int32 chunkSize = Configuration.GetChunkSize();
-	const int32 numVertices = Configuration.GetNumVertices();
-	const int32 topLeftX = currentJob.Offset.X - (chunkSize / 2.0f);
-	const int32 topLeftY = currentJob.Offset.Y - (chunkSize / 2.0f);
+	const int32 chunkSize = configuration.GetChunkSize();
+	const int32 numVertices = configuration.GetNumVertices();
 
-	/* Generate a height map if we need one or update it. */
- 	FArray2D* heightMap = bUpdateSection || chunk->HeightMap ? chunk->HeightMap : new FArray2D(numVertices, numVertices);
-	UNoiseGenerator* noiseGenerator = Configuration.NoiseGenerator;
-	if(!IsValid(noiseGenerator))
+	/* Everything is sampled relative to the chunk's origin. Only that is in double precision, the offsets from it are small. */
+	const FNoiseOrigin& origin = currentJob.NoiseOrigin;
+	const float topLeftX = chunkSize / -2.0f;
+	const float topLeftY = chunkSize / -2.0f;
+
+	const int32 meshSimplificationIncrement = levelOfDetail == 0 ? 1 : levelOfDetail * 2;
+
+	/* A chunk's height map is generated once and every LOD is meshed from it by taking every meshSimplificationIncrement'th sample,
+	 * so switching LODs doesn't evaluate any noise. Meshes that accumulate face normals need the ring of vertices one mesh simplification
+	 * increment outside of the mesh, so the apron is made wide enough for the coarsest LOD.
+	 * A chunk that starts out with a coarse LOD only gets the samples that LOD uses (the height map's stride), with the octaves culled
+	 * for that spacing. The full resolution height map is generated once a LOD needs samples in between.
+	 * A height map that was generated from other noise than our configuration's is no use to us at all. */
+	const bool bQuantizeHeightMap = configuration.HeightMapStorage == EHeightMapStorage::Quantized16;
+	const bool bHasHeightMap = (bQuantizeHeightMap ? currentJob.SourceQuantizedHeightMap.IsValid() : currentJob.SourceHeightMap.IsValid())
+		&& currentJob.SourceHeightMapVersion == currentJob.Snapshot->HeightMapVersion;
+	const int32 requiredApron = FMath::Max(configuration.HeightMapApron, bUpdateSection ? 0 : meshSimplificationIncrement);
+	const bool bCachedHeightMapUsable = bHasHeightMap && meshSimplificationIncrement % currentJob.SourceHeightMapStride == 0 
+		&& currentJob.SourceHeightMapApron * currentJob.SourceHeightMapStride >= requiredApron;
+
+	int32 heightMapStride = 1;
+	int32 heightMapApron = 0;
+	int32 heightMapSampleSpacing = 0;
+	if (bCachedHeightMapUsable)
 	{
-		UE_LOG(LogTemp, Error, TEXT("No noise generator"));
+		heightMapStride = currentJob.SourceHeightMapStride;
+		heightMapApron = currentJob.SourceHeightMapApron;
+		heightMapSampleSpacing = currentJob.SourceHeightMapSampleSpacing;
 	}
-
-	if (IsValid(noiseGenerator) && (bUpdateSection || chunk->HeightMap == nullptr))
+	else
 	{
-		heightMap->ForEachWithIndex([&](float& value, int32 xIndex, int32 yIndex)
+		if (configuration.bSparseHeightMapsForFarLODs)
 		{
-			const float X = topLeftX + xIndex;
-			const float Y = topLeftY + yIndex;
-
-			value = noiseGenerator->GetNoise2D(X, Y);
-		});
+			/* A stride that both this LOD and the LODs meshed from the current height map can use. */
+			heightMapStride = meshSimplificationIncrement;
+			for (int32 otherStride = bHasHeightMap ? currentJob.SourceHeightMapStride : 0; otherStride != 0;)
+			{
+				const int32 remainder = heightMapStride % otherStride;
+				heightMapStride = otherStride;
+				otherStride = remainder;
+			}
+		}
+		heightMapApron = FMath::DivideAndRoundUp(FMath::Max(requiredApron, configuration.GetMaxMeshSimplificationIncrement()), heightMapStride);
+		heightMapSampleSpacing = configuration.bCullOctavesForLOD ? heightMapStride : 0;
 	}
-	currentJob.GeneratedHeightMap = heightMap;
+	const int32 heightMapSize = (numVertices - 1) / heightMapStride + 1 + 2 * heightMapApron;
+	const bool bGenerateHeightMap = (bUpdateSection && currentJob.bRegenerateHeightMap) || !bCachedHeightMapUsable;
 
-	const int32 meshSimplificationIncrement = levelOfDetail == 0 ? 1 : levelOfDetail * 2;
-	const int32 verticesPerLine = (numVertices - 1) / meshSimplificationIncrement + 1;
-	TArray<float> borderHeightMap; borderHeightMap.SetNum(verticesPerLine * 4 + 4);
+	/* The chunk's height map is never written to, other jobs and the game thread may be reading it. A new one is generated into a
+	 * height map of our own, which the chunk takes over on the game thread. Quantized height maps are generated (or decoded) into
+	 * our scratch height map and only quantized once the mesh data is done. */
+	FArray2D* generatedHeightMap = nullptr;
+	const FArray2D* heightMap = nullptr;
+	if (bGenerateHeightMap && bQuantizeHeightMap)
+	{
+		if (DecodedHeightMap.GetWidth() != heightMapSize || DecodedHeightMap.GetHeight() != heightMapSize)
+		{
+			DecodedHeightMap = FArray2D(heightMapSize, heightMapSize);
+		}
+		generatedHeightMap = &DecodedHeightMap;
+	}
+	else if (bGenerateHeightMap)
+	{
+		TSharedRef<FArray2D, ESPMode::ThreadSafe> newHeightMap = MakeShared<FArray2D, ESPMode::ThreadSafe>(heightMapSize, heightMapSize);
+		generatedHeightMap = &newHeightMap.Get();
+		currentJob.GeneratedHeightMap = newHeightMap;
+	}
+	else if (bQuantizeHeightMap)
+	{
+		currentJob.SourceQuantizedHeightMap->Decode(DecodedHeightMap);
+		heightMap = &DecodedHeightMap;
+	}
+	else
+	{
+		heightMap = currentJob.SourceHeightMap.Get();
+	}
+	if (generatedHeightMap)
+	{
+		heightMap = generatedHeightMap;
+	}
 
-	/* Generate border height map */
-	if(IsValid(noiseGenerator))
+	UNoiseGenerator* noiseGenerator = configuration.NoiseGenerator;
+	if(!IsValid(noiseGenerator))
 	{
-		const int32 borderTopLeftX = topLeftX - meshSimplificationIncrement;
-		const int32 borderTopLeftY = topLeftY - meshSimplificationIncrement;
-		int32 vertexIndex = 0;
+		UE_LOG(LogTemp, Error, TEXT("No noise generator"));
+	}
 
-		/* Top row */
-		for (int32 x = 0; x < numVertices + (meshSimplificationIncrement * 2); x += meshSimplificationIncrement)
+	/* The whole padded height map is generated in one go. When the generator can compute the slope of the noise, the mesh normals
+	 * come straight from it. The slopes are kept with the height map, so meshes from a cached height map get the same normals.
+	 * Like the height map, new slopes go into our own arrays, quantized ones into our scratch arrays. */
+	const FArray2D* derivativesX = nullptr;
+	const FArray2D* derivativesY = nullptr;
+	if (IsValid(noiseGenerator) && bGenerateHeightMap)
+	{
+		TSharedPtr<FHeightMapDerivatives, ESPMode::ThreadSafe> newDerivatives;
+		FArray2D* generatedDerivativesX = &DecodedDerivativesX;
+		FArray2D* generatedDerivativesY = &DecodedDerivativesY;
+		if (bQuantizeHeightMap)
 		{
-			borderHeightMap[vertexIndex] = noiseGenerator->GetNoise2D(borderTopLeftX + x, borderTopLeftY);
-			vertexIndex++;
+			if (DecodedDerivativesX.GetWidth() != heightMapSize || DecodedDerivativesX.GetHeight() != heightMapSize)
+			{
+				DecodedDerivativesX = FArray2D(heightMapSize, heightMapSize);
+				DecodedDerivativesY = FArray2D(heightMapSize, heightMapSize);
+			}
 		}
-
-		/* Sides */
-		for (int32 y = meshSimplificationIncrement; y < numVertices + meshSimplificationIncrement; y += meshSimplificationIncrement)
+		else
 		{
-			borderHeightMap[vertexIndex] = noiseGenerator->GetNoise2D(borderTopLeftX, borderTopLeftY + y);
-			vertexIndex++;
-
-			borderHeightMap[vertexIndex] = noiseGenerator->GetNoise2D(borderTopLeftX + (2 * meshSimplificationIncrement) + chunkSize, borderTopLeftY + y);
-			vertexIndex++;
+			newDerivatives = MakeShared<FHeightMapDerivatives, ESPMode::ThreadSafe>(heightMapSize);
+			generatedDerivativesX = &newDerivatives->X;
+			generatedDerivativesY = &newDerivatives->Y;
 		}
 
-		/* Bottom row*/
-		for (int32 x = 0; x < numVertices + (meshSimplificationIncrement * 2); x += meshSimplificationIncrement)
+		if (noiseGenerator->GetNoise2DGridWithDerivatives(*generatedHeightMap, *generatedDerivativesX, *generatedDerivativesY, 
+			topLeftX - heightMapApron * heightMapStride, topLeftY - heightMapApron * heightMapStride, heightMapStride, heightMapSampleSpacing, origin))
 		{
-			borderHeightMap[vertexIndex] = noiseGenerator->GetNoise2D(borderTopLeftX + x, borderTopLeftY + (chunkSize + (2 * meshSimplificationIncrement)));
-			vertexIndex++;
+			derivativesX = generatedDerivativesX;
+			derivativesY = generatedDerivativesY;
+			currentJob.GeneratedHeightMapDerivatives = newDerivatives;
 		}
 	}
+	else if (!bGenerateHeightMap && bQuantizeHeightMap && currentJob.SourceQuantizedHeightMapDerivatives.IsValid())
+	{
+		currentJob.SourceQuantizedHeightMapDerivatives->Decode(DecodedDerivativesX, DecodedDerivativesY);
+		derivativesX = &DecodedDerivativesX;
+		derivativesY = &DecodedDerivativesY;
+	}
+	else if (!bGenerateHeightMap && currentJob.SourceHeightMapDerivatives.IsValid())
+	{
+		derivativesX = &currentJob.SourceHeightMapDerivatives->X;
+		derivativesY = &currentJob.SourceHeightMapDerivatives->Y;
+	}
+	currentJob.HeightMapSampleSpacing = heightMapSampleSpacing;
+	currentJob.HeightMapApron = heightMapApron;
+	currentJob.HeightMapStride = heightMapStride;
+	currentJob.HeightMapVersion = bGenerateHeightMap ? currentJob.Snapshot->HeightMapVersion : currentJob.SourceHeightMapVersion;
+
+	/* A new float height map is handed back anyway, so the work isn't lost. A quantized one isn't worth quantizing for nothing, it is just dropped. */
+	if (currentJob.IsSuperseded())
+	{
+		currentJob.DropOffQueue->Enqueue(currentJob);
+		return;
+	}
 
 	/* Generate or update mesh data. */
 	if (bUpdateSection)
 	{
-		currentJob.GeneratedMeshData = chunk->LODMeshes[levelOfDetail];
-		currentJob.GeneratedMeshData->UpdateMeshData(*heightMap, Configuration.Amplitude, borderHeightMap,Configuration.HeightCurve);
+		/* All of the chunk's meshes are updated from the same height map. The chunk's meshes may be uploaded or updated by the game
+		 * thread meanwhile, so the new heights go into mesh data of our own. */
+		for (const int32 lod : currentJob.UpdatedLODs)
+		{
+			currentJob.UpdatedMeshData.Add(FTerrainMeshData::CreateHeightUpdate(*heightMap, heightMapApron, heightMapStride, configuration.Amplitude, lod, 
+				configuration.HeightCurveTable.Get(), derivativesX, derivativesY, configuration.MeshAttributes, configuration.bPackNormals, configuration.NormalQuality));
+		}
 	}
 	else
 	{
-		currentJob.GeneratedMeshData = new FTerrainMeshData(*heightMap, Configuration.Amplitude, levelOfDetail, borderHeightMap, Configuration.HeightCurve, Configuration.MapScale);
+		currentJob.GeneratedMeshData = new FTerrainMeshData(*heightMap, heightMapApron, heightMapStride, configuration.Amplitude, levelOfDetail, configuration.HeightCurveTable.Get(), 
+			configuration.MapScale, derivativesX, derivativesY, configuration.MeshAttributes, configuration.bPackNormals, configuration.NormalQuality);
 	}
 
-	currentJob.DropOffQueue->Enqueue(currentJob);
-}
-
-//////////////////////////////////////////////////////
-void FTerrainGeneratorWorker::UpdateConfiguration(const FTerrainConfiguration& newConfig)
-{
-	Configuration.CopyConfiguration(newConfig);
-}
-
-//////////////////////////////////////////////////////
-void FTerrainGeneratorWorker::ClearJobQueue()
-{
-	FMeshDataJob job;
-	while (PendingJobs.Dequeue(job) || PriorityJobs.Dequeue(job))
+	if (bQuantizeHeightMap && bGenerateHeightMap)
 	{
-		delete job.GeneratedHeightMap;
-		delete job.GeneratedMeshData;
+		currentJob.GeneratedQuantizedHeightMap = MakeShared<const FQuantizedHeightMap, ESPMode::ThreadSafe>(*heightMap);
+		if (derivativesX && derivativesY)
+		{
+			currentJob.GeneratedQuantizedHeightMapDerivatives = MakeShared<const FQuantizedHeightMapDerivatives, ESPMode::ThreadSafe>(*derivativesX, *derivativesY);
+		}
 	}
+
+	currentJob.DropOffQueue->Enqueue(currentJob);
 }
@@ -0,0 +1,251 @@
+#include "TerrainJobScheduler.h"
+#include "Misc/ScopeLock.h"
+#include "HAL/Event.h"
+#include "HAL/PlatformProcess.h"
+
+
+/////////////////////////////////////////////////////
+void FTerrainJobScheduler::FJobDeque::PushBack(const FMeshDataJob& job)
+{
+	const int32 capacity = Jobs.Num();
+	if (Num == capacity)
+	{
+		/* Grow and unwrap the ring, so the jobs start at index 0 again. */
+		TArray<FMeshDataJob> newJobs;
+		newJobs.SetNum(FMath::Max(16, capacity * 2));
+		for (int32 i = 0; i < Num; i++)
+		{
+			newJobs[i] = MoveTemp(Jobs[(Head + i) % capacity]);
+		}
+		Jobs = MoveTemp(newJobs);
+		Head = 0;
+	}
+
+	Jobs[(Head + Num) % Jobs.Num()] = job;
+	++Num;
+}
+
+FMeshDataJob FTerrainJobScheduler::FJobDeque::PopFront()
+{
+	check(Num > 0);
+	FMeshDataJob job = MoveTemp(Jobs[Head]);
+	Head = (Head + 1) % Jobs.Num();
+	--Num;
+	return job;
+}
+
+FMeshDataJob FTerrainJobScheduler::FJobDeque::PopBack()
+{
+	check(Num > 0);
+	--Num;
+	return MoveTemp(Jobs[(Head + Num) % Jobs.Num()]);
+}
+
+void FTerrainJobScheduler::FJobDeque::Empty()
+{
+	Jobs.Empty();
+	Head = 0;
+	Num = 0;
+}
+
+/////////////////////////////////////////////////////
+FTerrainJobScheduler::FTerrainJobScheduler(int32 numWorkers)
+{
+	WorkerQueues.SetNum(numWorkers);
+	for (TUniquePtr<FWorkerQueue>& queue : WorkerQueues)
+	{
+		queue = MakeUnique<FWorkerQueue>();
+		queue->WakeUpEvent = FGenericPlatformProcess::GetSynchEventFromPool(false);
+	}
+}
+
+FTerrainJobScheduler::~FTerrainJobScheduler()
+{
+	for (TUniquePtr<FWorkerQueue>& queue : WorkerQueues)
+	{
+		FGenericPlatformProcess::ReturnSynchEventToPool(queue->WakeUpEvent);
+	}
+}
+
+/////////////////////////////////////////////////////
+void FTerrainJobScheduler::Submit(const FMeshDataJob& job, int32 priority)
+{
+	const int32 numWorkers = WorkerQueues.Num();
+	if (numWorkers == 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("No worker threads to submit the mesh data job to."));
+		return;
+	}
+
+	/* Prefer a worker that is waiting for a job, otherwise take the one with the fewest jobs. */
+	int32 targetIndex = NextWorker;
+	for (int32 i = 0; i < numWorkers; i++)
+	{
+		const int32 workerIndex = (NextWorker + i) % numWorkers;
+		const FWorkerQueue& queue = *WorkerQueues[workerIndex];
+		if (queue.bIdle && queue.NumJobs.GetValue() == 0)
+		{
+			targetIndex = workerIndex;
+			break;
+		}
+		if (queue.NumJobs.GetValue() < WorkerQueues[targetIndex]->NumJobs.GetValue())
+		{
+			targetIndex = workerIndex;
+		}
+	}
+	NextWorker = (targetIndex + 1) % numWorkers;
+
+	/* The target's event is always triggered, it stays signaled until the target waits for it the next time. */
+	FWorkerQueue& target = *WorkerQueues[targetIndex];
+	bool bTargetIdle = false;
+	{
+		FScopeLock lock(&target.Mutex);
+		target.Deques[FMath::Clamp(priority, 0, NumPriorities - 1)].PushBack(job);
+		target.NumJobs.Increment();
+		bTargetIdle = target.bIdle;
+	}
+	target.WakeUpEvent->Trigger();
+
+	/* If the target is busy, wake up an idle worker to steal the job. */
+	if (!bTargetIdle)
+	{
+		for (const TUniquePtr<FWorkerQueue>& queue : WorkerQueues)
+		{
+			if (queue->bIdle)
+			{
+				queue->WakeUpEvent->Trigger();
+				break;
+			}
+		}
+	}
+}
+
+/////////////////////////////////////////////////////
+bool FTerrainJobScheduler::GetNextJob(int32 workerIndex, FMeshDataJob& outJob)
+{
+	return PopOwnJob(*WorkerQueues[workerIndex], outJob) || StealJob(workerIndex, outJob);
+}
+
+bool FTerrainJobScheduler::PopOwnJob(FWorkerQueue& queue, FMeshDataJob& outJob)
+{
+	if (queue.NumJobs.GetValue() == 0)
+	{
+		return false;
+	}
+
+	FScopeLock lock(&queue.Mutex);
+	for (FJobDeque& deque : queue.Deques)
+	{
+		if (deque.Num > 0)
+		{
+			outJob = deque.PopFront();
+			queue.NumJobs.Decrement();
+			return true;
+		}
+	}
+	return false;
+}
+
+bool FTerrainJobScheduler::StealJob(int32 thiefIndex, FMeshDataJob& outJob)
+{
+	/* The victim's job counts can change while we look at them. That only makes the choice of the victim less than ideal,
+	 * the deques are checked again under the lock. */
+	int32 victimIndex = INDEX_NONE;
+	int32 victimNumJobs = 0;
+	for (int32 i = 0; i < WorkerQueues.Num(); i++)
+	{
+		const int32 numJobs = WorkerQueues[i]->NumJobs.GetValue();
+		if (i != thiefIndex && numJobs > victimNumJobs)
+		{
+			victimIndex = i;
+			victimNumJobs = numJobs;
+		}
+	}
+	if (victimIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	FWorkerQueue& victim = *WorkerQueues[victimIndex];
+	FScopeLock lock(&victim.Mutex);
+	for (FJobDeque& deque : victim.Deques)
+	{
+		if (deque.Num > 0)
+		{
+			outJob = deque.PopBack();
+			victim.NumJobs.Decrement();
+			NumStolenJobs.Increment();
+			return true;
+		}
+	}
+	return false;
+}
+
+/////////////////////////////////////////////////////
+void FTerrainJobScheduler::WaitForJob(int32 workerIndex, bool bReturnIfJobsQueued /*= true*/)
+{
+	FWorkerQueue& queue = *WorkerQueues[workerIndex];
+	{
+		FScopeLock lock(&queue.Mutex);
+		queue.bIdle = true;
+	}
+
+	/* A job that was submitted after we last looked would otherwise only be picked up with the next submit. */
+	if (!bReturnIfJobsQueued || !HasJobs())
+	{
+		queue.WakeUpEvent->Wait();
+	}
+	queue.bIdle = false;
+}
+
+bool FTerrainJobScheduler::HasJobs() const
+{
+	for (const TUniquePtr<FWorkerQueue>& queue : WorkerQueues)
+	{
+		if (queue->NumJobs.GetValue() > 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void FTerrainJobScheduler::WakeUp(int32 workerIndex)
+{
+	WorkerQueues[workerIndex]->WakeUpEvent->Trigger();
+}
+
+void FTerrainJobScheduler::Reprioritize(TFunctionRef<int32(const FMeshDataJob&)> getPriority)
+{
+	TArray<FMeshDataJob> jobs;
+	for (TUniquePtr<FWorkerQueue>& queue : WorkerQueues)
+	{
+		FScopeLock lock(&queue->Mutex);
+		jobs.Reset(queue->NumJobs.GetValue());
+		for (FJobDeque& deque : queue->Deques)
+		{
+			while (deque.Num > 0)
+			{
+				jobs.Add(deque.PopFront());
+			}
+		}
+
+		for (const FMeshDataJob& job : jobs)
+		{
+			queue->Deques[FMath::Clamp(getPriority(job), 0, NumPriorities - 1)].PushBack(job);
+		}
+	}
+}
+
+void FTerrainJobScheduler::ClearJobs()
+{
+	for (TUniquePtr<FWorkerQueue>& queue : WorkerQueues)
+	{
+		FScopeLock lock(&queue->Mutex);
+		for (FJobDeque& deque : queue->Deques)
+		{
+			deque.Empty();
+		}
+		queue->NumJobs.Set(0);
+	}
+}
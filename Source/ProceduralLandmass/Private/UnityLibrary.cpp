@@ -2,12 +2,21 @@
 
 #include "Public/UnityLibrary.h"
 #include "Engine/Texture2D.h"
-#include <ThreadSafeBool.h>
+#include "Async/ParallelFor.h"
 #include "Array2D.h"
+#include "NoiseKernels.h"
 #include <Kismet/GameplayStatics.h>
 #include <Engine/World.h>
 
 
+namespace
+{
+	/* The library's Perlin noise always uses seed 5. The tables are generated once when the module is loaded and never change,
+	 * so any number of threads can read them without locking. */
+	const FPerlinNoiseTables GLibraryNoiseTables(5);
+}
+
+
 /////////////////////////////////////////////////////
 			/* Noise functions */
 /////////////////////////////////////////////////////
@@ -18,153 +27,82 @@ float UUnityLibrary::PerlinNoise(float x, float y)
 
 float UUnityLibrary::PerlinNoise(const FVector2D& vec)
 {
-	const int32 B = 256;
-	const int32 N = 4096;
-	const int32 BM = 255;
-
-	static int32 p[B + B + 2];
-	static float g1[B + B + 2];
-	static TArray<FVector2D> g2;
-	static TArray<FVector> g3;
-	
-	const auto sCurve = [](float t) -> float
-	{
-		return t * t * (3.0f - 2.0f * t);
-	};
-
-	const auto setup = [&](int32 i, int32& b0, int32& b1, float& r0, float& r1, float& t) -> void
-	{
-		t = vec[i] + N;
-		b0 = ((int32)t) & BM;
-		b1 = (b0 + 1) & BM;
-		r0 = t - (int32)t;
-		r1 = r0 - 1.;
-	};
-
-	const auto at2 = [](float rx, float ry, const FVector2D& q) -> float
-	{
-		return rx * q[0] + ry * q[1];
-	};
+	return FNoiseKernels::Perlin(GLibraryNoiseTables, vec);
+}
 
-	static FThreadSafeBool bIsFirstCall = true;
-	if (bIsFirstCall)
+void UUnityLibrary::PerlinNoiseLine(float* outValues, int32 numValues, float startX, float startY, float stepX, float stepY)
+{
+	int32 i = 0;
+	for (; i + 4 <= numValues; i += 4)
 	{
-		bIsFirstCall = false;
-
-		FRandomStream rand(5);
-
-		g2.SetNum(B + B + 2);
-		g3.SetNum(B + B + 2);
-
-		int i, j, k;
-		for (i = 0; i < B; i++)
+		MS_ALIGN(16) float sampleX[4] GCC_ALIGN(16);
+		MS_ALIGN(16) float sampleY[4] GCC_ALIGN(16);
+		for (int32 lane = 0; lane < 4; ++lane)
 		{
-			p[i] = i;
-
-			g1[i] = (rand.FRand() * 2) - 1;
-
-			for (j = 0; j < 2; j++)
-			{
-				g2[i][j] = (rand.FRand() * 2) - 1;
-				g2[i].Normalize();
-			}
-
-			for (j = 0; j < 3; j++)
-			{
-				g3[i][j] = (rand.FRand() * 2) - 1;
-				g3[i].Normalize();
-			}
+			sampleX[lane] = startX + (i + lane) * stepX;
+			sampleY[lane] = startY + (i + lane) * stepY;
 		}
 
-		while (--i)
-		{
-			k = p[i];
-			p[i] = p[j = rand.RandRange(0, 255)];
-			p[j] = k;
-		}
-
-		for (i = 0; i < B + 2; i++)
-		{
-			p[B + i] = p[i];
-			g1[B + i] = g1[i];
-			for (j = 0; j < 2; j++)
-			{
-				g2[B + i][j] = g2[i][j];
-			}
-			for (j = 0; j < 3; j++)
-			{
-				g3[B + i][j] = g3[i][j];
-			}
-		}
+		VectorStore(FNoiseKernels::Perlin4(GLibraryNoiseTables, VectorLoadAligned(sampleX), VectorLoadAligned(sampleY)), outValues + i);
 	}
 
-	int32 bx0, bx1, by0, by1, b00, b10, b01, b11;
-	float rx0, rx1, ry0, ry1, sx, sy, a, b, t, u, v;
-	FVector2D q;
-	int32 i, j;
-
-	setup(0, bx0, bx1, rx0, rx1, t);
-	setup(1, by0, by1, ry0, ry1, t);
-
-	i = p[bx0];
-	j = p[bx1];
-
-	b00 = p[i + by0];
-	b10 = p[j + by0];
-	b01 = p[i + by1];
-	b11 = p[j + by1];
-
-	sx = sCurve(rx0);
-	sy = sCurve(ry0);
-
-	q = g2[b00]; u = at2(rx0, ry0, q);
-	q = g2[b10]; v = at2(rx1, ry0, q);
-	a = FMath::Lerp(u, v, sx);
-
-	q = g2[b01]; u = at2(rx0, ry1, q);
-	q = g2[b11]; v = at2(rx1, ry1, q);
-	b = FMath::Lerp(u, v, sx);
+	/* Remaining samples */
+	for (; i < numValues; ++i)
+	{
+		outValues[i] = PerlinNoise(startX + i * stepX, startY + i * stepY);
+	}
+}
 
-	return FMath::Lerp(a, b, sy);
+void UUnityLibrary::PerlinNoiseGrid(FArray2D& outValues, const FVector2D& origin, float step /*= 1.0f*/)
+{
+	const int32 width = outValues.GetWidth();
+	ParallelFor(outValues.GetHeight(), [&](int32 y)
+	{
+		PerlinNoiseLine(outValues.GetRow(y), width, origin.X, origin.Y + y * step, step, 0.0f);
+	});
 }
 
 
 /////////////////////////////////////////////////////
 			/* Falloff Generator */
 /////////////////////////////////////////////////////
+float UUnityLibrary::EvaluateFalloff(float value)
+{
+	const float a = 3;
+	const float b = 2.2f;
+	return FMath::Pow(value, b) / (FMath::Pow(value, a) + FMath::Pow(b - b * value, a));
+}
+
 FArray2D* UUnityLibrary::GenerateFalloffMap(int32 size)
 {
-	const auto evaluate = [](float value)
+	FArray2D* map = new FArray2D(size, size);
+	/* The falloff is separable into max(|x|, |y|), so every row is a plain loop over the precomputed column distances. */
+	TArray<float> columnDistances; columnDistances.SetNumUninitialized(size);
+	for (int32 x = 0; x < size; x++)
 	{
-		const float a = 3;
-		const float b = 2.2f;
-		return FMath::Pow(value, b) / (FMath::Pow(value, a) + FMath::Pow(b - b * value, a));
-	};
+		columnDistances[x] = FMath::Abs(x / (float)size * 2.0f - 1);
+	}
 
-	FArray2D* map = new FArray2D(size, size);
-	map->ForEachWithIndex([=](int32 x, int32 y, float& value)
+	const float* RESTRICT distances = columnDistances.GetData();
+	for (int32 y = 0; y < size; y++)
 	{
-		float xValue = x / (float)size * 2.0f - 1;
-		float yValue = y / (float)size * 2.0f - 1;
-		value = evaluate(FMath::Max(FMath::Abs(xValue), FMath::Abs(yValue)));
-	});
+		const float yDistance = FMath::Abs(y / (float)size * 2.0f - 1);
+		float* RESTRICT row = map->GetRow(y);
+		for (int32 x = 0; x < size; x++)
+		{
+			row[x] = EvaluateFalloff(FMath::Max(distances[x], yDistance));
+		}
+	}
 
 	return map;
 }
 
 float UUnityLibrary::GetFalloffValue(int32 x, int32 y, int32 size)
 {
-	const auto evaluate = [](float value)
-	{
-		const float a = 3;
-		const float b = 2.2f;
-		return FMath::Pow(value, b) / (FMath::Pow(value, a) + FMath::Pow(b - b * value, a));
-	};
-
 	const float xValue = x / (float)size * 2.0f - 1;
 	const float yValue = y / (float)size * 2.0f - 1;
 
-	return evaluate(FMath::Max(FMath::Abs(xValue), FMath::Abs(yValue)));
+	return EvaluateFalloff(FMath::Max(FMath::Abs(xValue), FMath::Abs(yValue)));
 }
 
 float UUnityLibrary::GetValueWithFalloff(float value, int32 x, int32 y, int32 size)
@@ -202,6 +140,12 @@ FVector UUnityLibrary::GetCameraLocation(const UObject* worldContextObject)
 	return cameraLocation;
 }
 
+FVector UUnityLibrary::GetCameraDirection(const UObject* worldContextObject)
+{
+	const APlayerCameraManager* cameraManager = UGameplayStatics::GetPlayerCameraManager(worldContextObject, 0);
+	return IsValid(cameraManager) ? cameraManager->GetCameraRotation().Vector() : FVector::ZeroVector;
+}
+
 
 /////////////////////////////////////////////////////
 					/* Texture */
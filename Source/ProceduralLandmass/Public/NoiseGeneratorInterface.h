@@ -1,9 +1,20 @@
 #pragma once
 #include "CoreMinimal.h"
 #include "Object.h"
+#include "UObject/UnrealType.h"
+#include "Array2D.h"
+#include "NoiseOrigin.h"
 #include "NoiseGeneratorInterface.generated.h"
 
 
+DECLARE_STATS_GROUP(TEXT("Noise"), STATGROUP_Noise, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT(TEXT("GetNoise2DGrid"), STAT_GetNoise2DGrid, STATGROUP_Noise);
+DECLARE_CYCLE_STAT(TEXT("GetNoise3DBrick"), STAT_GetNoise3DBrick, STATGROUP_Noise);
+DECLARE_DWORD_COUNTER_STAT(TEXT("2D grid samples"), STAT_NoiseSamples2D, STATGROUP_Noise);
+DECLARE_DWORD_COUNTER_STAT(TEXT("3D brick samples"), STAT_NoiseSamples3D, STATGROUP_Noise);
+
+
 UCLASS(Abstract, Blueprintable)
 class PROCEDURALLANDMASS_API UNoiseGenerator : public UObject
 {
@@ -27,14 +38,137 @@ public:
 		OctaveOffsets = otherGenerator->OctaveOffsets;
 	};
 
+	/**
+	 * Returns a hash of the class and all editable properties, e.g. the noise parameters or a noise graph's nodes.
+	 * Two generators with the same hash generate the same noise.
+	 */
+	uint32 GetParametersHash() const
+	{
+		uint32 hash = GetTypeHash(GetClass());
+		for (TFieldIterator<UProperty> it(GetClass()); it; ++it)
+		{
+			if (it->HasAnyPropertyFlags(CPF_Edit))
+			{
+				FString value;
+				it->ExportTextItem(value, it->ContainerPtrToValuePtr<void>(this), nullptr, nullptr, PPF_None);
+				hash = HashCombine(hash, FCrc::StrCrc32(*value));
+			}
+		}
+		return hash;
+	};
+
     UFUNCTION(BlueprintNativeEvent, BlueprintPure, Category = "Noise Generator")
     float GetNoise2D(float X, float Y) const;
     virtual float GetNoise2D_Implementation(float X, float Y) const { return 0.0f; };
 
+	/**
+	 * Native batch entry point. Samples the noise along a line, so that
+	 * outValues[i] = GetNoise2D(startX + i * stepX, startY + i * stepY).
+	 * The default implementation falls back to one GetNoise2D call per sample (so Blueprint generators still work),
+	 * native generators should override this with a tight loop.
+	 * @param outValues Must have room for at least numValues floats.
+	 * @param sampleSpacing The distance between the samples the result will be used with (e.g. the mesh simplification increment).
+	 * Native generators fade out and skip octaves that are too fine to be represented at this spacing. 0 evaluates all octaves.
+	 * @param origin The start is relative to this origin (@see FNoiseOrigin). Native generators keep their precision at any distance,
+	 * the default implementation adds the origin in float.
+	 */
+	virtual void GetNoise2DLine(float* outValues, int32 numValues, float startX, float startY, float stepX, float stepY, float sampleSpacing = 0.0f,
+		const FNoiseOrigin& origin = FNoiseOrigin()) const
+	{
+		for (int32 i = 0; i < numValues; ++i)
+		{
+			outValues[i] = GetNoise2D(origin.X + (startX + i * stepX), origin.Y + (startY + i * stepY));
+		}
+	};
+
+	/**
+	 * Fills the entire array row by row with @see GetNoise2DLine.
+	 * The value at column x and row y will be the noise at origin + (startX + x * step, startY + y * step).
+	 * @param sampleSpacing @see GetNoise2DLine
+	 */
+	void GetNoise2DGrid(FArray2D& outValues, float startX, float startY, float step = 1.0f, float sampleSpacing = 0.0f, const FNoiseOrigin& origin = FNoiseOrigin()) const
+	{
+		SCOPE_CYCLE_COUNTER(STAT_GetNoise2DGrid);
+		INC_DWORD_STAT_BY(STAT_NoiseSamples2D, outValues.GetWidth() * outValues.GetHeight());
+
+		const int32 width = outValues.GetWidth();
+		for (int32 y = 0; y < outValues.GetHeight(); ++y)
+		{
+			GetNoise2DLine(outValues.GetRow(y), width, startX, startY + y * step, step, 0.0f, sampleSpacing, origin);
+		}
+	};
+
+	/**
+	 * Like @see GetNoise2DLine, but also returns the partial derivatives of the noise with respect to X and Y (the slope of the
+	 * noise per world unit). Generators that can compute them analytically override this.
+	 * The default implementation only fills outValues and returns false.
+	 * @param outDerivativesX, outDerivativesY Must have room for at least numValues floats.
+	 * @return True if the derivatives were written.
+	 */
+	virtual bool GetNoise2DLineWithDerivatives(float* outValues, float* outDerivativesX, float* outDerivativesY, int32 numValues, 
+		float startX, float startY, float stepX, float stepY, float sampleSpacing = 0.0f, const FNoiseOrigin& origin = FNoiseOrigin()) const
+	{
+		GetNoise2DLine(outValues, numValues, startX, startY, stepX, stepY, sampleSpacing, origin);
+		return false;
+	};
+
+	/**
+	 * Fills the arrays row by row with @see GetNoise2DLineWithDerivatives. All three arrays must have the same size.
+	 * @return True if the derivatives were written. Otherwise only outValues was filled.
+	 */
+	bool GetNoise2DGridWithDerivatives(FArray2D& outValues, FArray2D& outDerivativesX, FArray2D& outDerivativesY, float startX, float startY, 
+		float step = 1.0f, float sampleSpacing = 0.0f, const FNoiseOrigin& origin = FNoiseOrigin()) const
+	{
+		SCOPE_CYCLE_COUNTER(STAT_GetNoise2DGrid);
+		INC_DWORD_STAT_BY(STAT_NoiseSamples2D, outValues.GetWidth() * outValues.GetHeight());
+
+		const int32 width = outValues.GetWidth();
+		bool bHasDerivatives = true;
+		for (int32 y = 0; y < outValues.GetHeight(); ++y)
+		{
+			bHasDerivatives &= GetNoise2DLineWithDerivatives(outValues.GetRow(y), outDerivativesX.GetRow(y), outDerivativesY.GetRow(y), width, 
+				startX, startY + y * step, step, 0.0f, sampleSpacing, origin);
+		}
+		return bHasDerivatives;
+	};
+
     UFUNCTION(BlueprintNativeEvent, BlueprintPure, Category = "Noise Generator")
     float GetNoise3D(float X, float Y, float Z) const;
     virtual float GetNoise3D_Implementation(float X, float Y, float Z) const { return 0.0f; };
 
+	/**
+	 * Native batch entry point for 3D noise. Samples a row in X direction, so that
+	 * outValues[i] = GetNoise3D(startX + i * stepX, Y, Z).
+	 * The default implementation falls back to one GetNoise3D call per sample, native generators should override this.
+	 * @param outValues Must have room for at least numValues floats.
+	 */
+	virtual void GetNoise3DRow(float* outValues, int32 numValues, float startX, float Y, float Z, float stepX) const
+	{
+		for (int32 i = 0; i < numValues; ++i)
+		{
+			outValues[i] = GetNoise3D(startX + i * stepX, Y, Z);
+		}
+	};
+
+	/**
+	 * Fills a dense brick of size.X * size.Y * size.Z samples row by row with @see GetNoise3DRow.
+	 * The value for x, y, z is at outValues[x + (y + z * size.Y) * size.X] and is the noise at origin + (x, y, z) * step.
+	 * @param outValues Must have room for at least size.X * size.Y * size.Z floats.
+	 */
+	void GetNoise3DBrick(float* outValues, const FIntVector& size, const FVector& origin, float step = 1.0f) const
+	{
+		SCOPE_CYCLE_COUNTER(STAT_GetNoise3DBrick);
+		INC_DWORD_STAT_BY(STAT_NoiseSamples3D, size.X * size.Y * size.Z);
+
+		for (int32 z = 0; z < size.Z; ++z)
+		{
+			for (int32 y = 0; y < size.Y; ++y)
+			{
+				GetNoise3DRow(&outValues[(y + z * size.Y) * size.X], size.X, origin.X, origin.Y + y * step, origin.Z + z * step, step);
+			}
+		}
+	};
+
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, meta = (ExposeOnSpawn = true))
 	float NoiseScale = 50.0f;
 
@@ -56,4 +190,23 @@ public:
 
 	UPROPERTY(BlueprintReadWrite)
 	TArray<FVector2D> OctaveOffsets;
+
+protected:
+	/** Draws a random offset for each octave from the stream and calculates the theoretical highest value (@see Limit). */
+	void InitOctaves(FRandomStream& rand)
+	{
+		OctaveOffsets.SetNum(Octaves);
+		for (FVector2D& offsetVec : OctaveOffsets)
+		{
+			const float offsetX = rand.FRandRange(-1000.0f, 1000.0f);
+			const float offsetY = rand.FRandRange(-1000.0f, 1000.0f);
+			offsetVec = FVector2D(offsetX, offsetY);
+		}
+
+		// Calculate the theoretical highest values
+		for (int32 i = 0; i < Octaves; ++i)
+		{
+			Limit += FMath::Pow(Persistence, i);
+		}
+	};
 };
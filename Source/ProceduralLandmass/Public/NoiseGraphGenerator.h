@@ -0,0 +1,76 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NoiseGeneratorInterface.h"
+#include "PerlinNoiseTables.h"
+#include "Structs/HeightCurveTable.h"
+#include "Structs/NoiseGraphNode.h"
+#include "NoiseGraphGenerator.generated.h"
+
+/**
+ * Native noise generator that is authored as data: a graph of noise sources, fractal combinators, domain warps,
+ * curves, arithmetic and falloff nodes (@see FNoiseGraphNode).
+ * To use it, create a Blueprint subclass, fill in Nodes in its class defaults and select it as the terrain's noise generator class.
+ *
+ * The nodes are compiled into a flat program that is evaluated in blocks of samples, one tight (vectorized) loop per node,
+ * so complex terrains don't pay for the Blueprint VM per vertex.
+ * The last node is the output, clamped to 0..1. Uses the generator's NoiseScale and Seed, octaves, persistence and lacunarity are set per node.
+ */
+UCLASS(Blueprintable)
+class PROCEDURALLANDMASS_API UNoiseGraphGenerator : public UNoiseGenerator
+{
+	GENERATED_BODY()
+
+public:
+	virtual float GetNoise2D_Implementation(float X, float Y) const override;
+	virtual void GetNoise2DLine(float* outValues, int32 numValues, float startX, float startY, float stepX, float stepY, float sampleSpacing = 0.0f,
+		const FNoiseOrigin& origin = FNoiseOrigin()) const override;
+	virtual void CopyGenerator_Implementation(const UNoiseGenerator* otherGenerator) override;
+
+	virtual void PostInitProperties() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	/** Compiles the nodes into the program we evaluate. Has to be called when the nodes are changed at runtime. */
+	UFUNCTION(BlueprintCallable, Category = "Noise Graph")
+	void CompileGraph();
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Noise Graph")
+	TArray<FNoiseGraphNode> Nodes;
+
+private:
+	/* A compiled node. Reads from and writes to registers, which are blocks of samples. */
+	struct FInstruction
+	{
+		FNoiseGraphNode Node;
+
+		int32 Output = 0;
+		int32 InputA = 0;
+		int32 InputB = 0;
+		int32 InputC = 0;
+		int32 CoordinatesX = 0;
+		int32 CoordinatesY = 0;
+
+		/* Noise nodes: one random offset per octave and the sum of all octave amplitudes. */
+		TArray<FVector2D> OctaveOffsets;
+		float Limit = 1.0f;
+
+		/* Curve nodes: the curve baked over its key range. The worker threads never touch the curve itself. */
+		TSharedPtr<const FHeightCurveTable, ESPMode::ThreadSafe> CurveTable;
+	};
+
+	TArray<FInstruction> Program;
+	int32 NumRegisters = 0;
+	int32 OutputRegister = 0;
+
+	/* Permutation and gradient tables for our seed. */
+	TSharedPtr<const FPerlinNoiseTables, ESPMode::ThreadSafe> Tables;
+
+	/**
+	 * Executes a single instruction on the first numLanes samples of the registers. numLanes is a multiple of 4.
+	 * @param sampleSpacing Distance between the samples, divided by the noise scale.
+	 * @param origin The origin the positions in the registers are relative to, divided by the noise scale.
+	 */
+	void Execute(const FInstruction& instruction, float* registers, int32 numLanes, float sampleSpacing, const FNoiseOrigin& origin) const;
+};
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "NoiseGeneratorInterface.h"
+#include "PerlinNoiseTables.h"
 #include "PerlinNoiseModule.generated.h"
 
 /**
@@ -19,18 +20,17 @@ public:
 	UPerlinNoiseModule(float noiseScale, int32 seed, float persistence, float lacunarity, int32 octaves);
     
     virtual float GetNoise2D_Implementation(float X, float Y) const override;
+	virtual void GetNoise2DLine(float* outValues, int32 numValues, float startX, float startY, float stepX, float stepY, float sampleSpacing = 0.0f,
+		const FNoiseOrigin& origin = FNoiseOrigin()) const override;
+	virtual bool GetNoise2DLineWithDerivatives(float* outValues, float* outDerivativesX, float* outDerivativesY, int32 numValues, 
+		float startX, float startY, float stepX, float stepY, float sampleSpacing = 0.0f, const FNoiseOrigin& origin = FNoiseOrigin()) const override;
+	virtual float GetNoise3D_Implementation(float X, float Y, float Z) const override;
+	virtual void GetNoise3DRow(float* outValues, int32 numValues, float startX, float Y, float Z, float stepX) const override;
 	virtual void CopyGenerator_Implementation(const UNoiseGenerator* otherGenerator) override;
 
-    TArray<int32> p;
-    TArray<float> g1;
-	TArray<FVector2D> g2;
-	TArray<FVector> g3;
+	/* Permutation and gradient tables. Shared between all generators (and their copies) with the same seed. */
+	TSharedPtr<const FPerlinNoiseTables, ESPMode::ThreadSafe> Tables;
 
 private:
     void Init();
-	float PerlinNoise(FVector2D vec) const;
-
-    const int32 B = 256;
-    const int32 N = 4096;
-    const int32 BM = 255;
 };
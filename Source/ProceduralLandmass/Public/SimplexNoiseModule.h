@@ -0,0 +1,37 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "NoiseGeneratorInterface.h"
+#include "PerlinNoiseTables.h"
+#include "SimplexNoiseModule.generated.h"
+
+/**
+ * 2D simplex noise with the OpenSimplex2 kernel (radius^2 = 0.5, (r^2 - d^2)^4 falloff).
+ * Each sample only needs the three corners of its simplex instead of the four of a Perlin lattice cell.
+ * Uses the same noise scale, octaves, persistence, lacunarity and octave offsets as @see UPerlinNoiseModule
+ * and the same (shared) permutation and gradient tables for hashing.
+ */
+UCLASS()
+class PROCEDURALLANDMASS_API USimplexNoiseModule : public UNoiseGenerator
+{
+	GENERATED_BODY()
+	
+public:
+	USimplexNoiseModule();
+	USimplexNoiseModule(float noiseScale, int32 seed, float persistence, float lacunarity, int32 octaves);
+
+	virtual float GetNoise2D_Implementation(float X, float Y) const override;
+	virtual void GetNoise2DLine(float* outValues, int32 numValues, float startX, float startY, float stepX, float stepY, float sampleSpacing = 0.0f,
+		const FNoiseOrigin& origin = FNoiseOrigin()) const override;
+	virtual bool GetNoise2DLineWithDerivatives(float* outValues, float* outDerivativesX, float* outDerivativesY, int32 numValues, 
+		float startX, float startY, float stepX, float stepY, float sampleSpacing = 0.0f, const FNoiseOrigin& origin = FNoiseOrigin()) const override;
+	virtual float GetNoise3D_Implementation(float X, float Y, float Z) const override;
+	virtual void GetNoise3DRow(float* outValues, int32 numValues, float startX, float Y, float Z, float stepX) const override;
+	virtual void CopyGenerator_Implementation(const UNoiseGenerator* otherGenerator) override;
+
+	/* Permutation and gradient tables. Shared between all generators (and their copies) with the same seed. */
+	TSharedPtr<const FPerlinNoiseTables, ESPMode::ThreadSafe> Tables;
+
+private:
+	void Init();
+};
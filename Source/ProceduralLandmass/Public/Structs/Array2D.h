@@ -1,6 +1,7 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Containers/ArrayView.h"
 #include "Kismet/BlueprintFunctionLibrary.h"
 #include "Array2D.generated.h"
 
@@ -15,10 +16,10 @@ protected:
 	TArray<float> ArrayIntern;
 
 	UPROPERTY(BlueprintReadOnly)
-	int32 NumRows;
+	int32 NumRows = 0;
 
 	UPROPERTY(BlueprintReadOnly)
-	int32 NumColumns;
+	int32 NumColumns = 0;
 
 public:
 	FArray2D() {};
@@ -30,21 +31,33 @@ public:
 	 */
 	FArray2D(int32 sizeX, int32 sizeY)
 	{
-		ArrayIntern = TArray<float>();
-		ArrayIntern.SetNum(sizeX * sizeY);
+		ArrayIntern.SetNumZeroed(sizeX * sizeY);
 
 		NumRows = sizeY;
 		NumColumns = sizeX;
 	};
 
-	FArray2D(const FArray2D& otherArray)
+	/* The values are stored contiguously, so copies are a single memcpy and moves just take over the allocation. */
+	FArray2D(const FArray2D& otherArray) = default;
+	FArray2D(FArray2D&& otherArray)
+		: ArrayIntern(MoveTemp(otherArray.ArrayIntern)), NumRows(otherArray.NumRows), NumColumns(otherArray.NumColumns)
 	{
-		ArrayIntern.SetNum(otherArray.NumColumns * otherArray.NumRows);
-		this->NumRows = otherArray.NumRows;
-		this->NumColumns = otherArray.NumColumns;
+		otherArray.NumRows = 0;
+		otherArray.NumColumns = 0;
+	}
 
-		const auto lamdba = [&](int32 x, int32 y, float& value) { value = otherArray.GetValue(x, y); };
-		ForEachWithIndex(lamdba);
+	FArray2D& operator=(const FArray2D& otherArray) = default;
+	FArray2D& operator=(FArray2D&& otherArray)
+	{
+		if (this != &otherArray)
+		{
+			ArrayIntern = MoveTemp(otherArray.ArrayIntern);
+			NumRows = otherArray.NumRows;
+			NumColumns = otherArray.NumColumns;
+			otherArray.NumRows = 0;
+			otherArray.NumColumns = 0;
+		}
+		return *this;
 	}
 
 	FORCEINLINE float operator[] (int32 index) const
@@ -71,45 +84,62 @@ public:
 
 	FORCEINLINE int32 GetHeight() const { return NumRows; };
 	FORCEINLINE int32 GetWidth() const { return NumColumns; };
+	FORCEINLINE int32 Num() const { return ArrayIntern.Num(); };
+
+	FORCEINLINE float* GetData() { return ArrayIntern.GetData(); };
+	FORCEINLINE const float* GetData() const { return ArrayIntern.GetData(); };
+
+	/* Returns a pointer to the first value of row y. The row is GetWidth() values long. */
+	FORCEINLINE float* GetRow(int32 y)
+	{
+		checkSlow(y >= 0 && y < NumRows);
+		return ArrayIntern.GetData() + y * NumColumns;
+	}
 
-	/* Loops through the entire array, row by row and calls the lambda with each value as a parameter (passed by reference). */
-	void ForEach(TFunction<void (float& value)> lambda)
+	FORCEINLINE const float* GetRow(int32 y) const
 	{
-		for (int32 y = 0; y < NumColumns; y++)
+		checkSlow(y >= 0 && y < NumRows);
+		return ArrayIntern.GetData() + y * NumColumns;
+	}
+
+	/* Returns row y as a view. */
+	FORCEINLINE TArrayView<float> GetRowView(int32 y) { return TArrayView<float>(GetRow(y), NumColumns); };
+	FORCEINLINE TArrayView<const float> GetRowView(int32 y) const { return TArrayView<const float>(GetRow(y), NumColumns); };
+
+	/* Loops through the entire array, row by row and calls the function with each value as a parameter (passed by reference). */
+	template<typename FunctionType>
+	FORCEINLINE void ForEach(FunctionType&& function)
+	{
+		float* RESTRICT values = ArrayIntern.GetData();
+		const int32 num = ArrayIntern.Num();
+		for (int32 i = 0; i < num; i++)
 		{
-			for (int32 x = 0; x < NumRows; x++)
-			{
-				float& value = ArrayIntern[y * NumColumns + x];
-				lambda(value);
-			}
+			function(values[i]);
 		}
 	}
 
-	/* Loops through the entire array, row by row and calls the lambda with each value as the first parameter (passed by reference)
-	 * and the current X and Y position as second and third parameter. */
-	void ForEachWithIndex(TFunction<void (float& value, int32 xIndex, int32 yIndex)> lambda)
+	/* Loops through the entire array, row by row and calls the function with the current X and Y position as first and second
+	 * parameter and the value as the third (passed by reference). */
+	template<typename FunctionType>
+	FORCEINLINE void ForEachWithIndex(FunctionType&& function)
 	{
-		for (int32 y = 0; y < NumColumns; y++)
+		for (int32 y = 0; y < NumRows; y++)
 		{
-			for (int32 x = 0; x < NumRows; x++)
+			float* RESTRICT row = GetRow(y);
+			for (int32 x = 0; x < NumColumns; x++)
 			{
-				float& value = ArrayIntern[y * NumColumns + x];
-				lambda(value, x, y);
+				function(x, y, row[x]);
 			}
 		}
 	}
 
-	/* Loops through the entire array, row by row and calls the lambda with each value as the first parameter (passed by reference)
-	 * and the current X and Y position as second and third parameter. */
-	void ForEachWithIndex(TFunctionRef<void (int32 xIndex, int32 yIndex, float& value)> lambda)
+	/* Loops through the rows and calls the function with the row index, a pointer to the row's first value and the row's length. */
+	template<typename FunctionType>
+	FORCEINLINE void ForEachRow(FunctionType&& function)
 	{
-		for (int32 y = 0; y < NumColumns; y++)
+		for (int32 y = 0; y < NumRows; y++)
 		{
-			for (int32 x = 0; x < NumRows; x++)
-			{
-				float& value = ArrayIntern[y * NumColumns + x];
-				lambda(x, y, value);
-			}
+			function(y, GetRow(y), NumColumns);
 		}
 	}
 };
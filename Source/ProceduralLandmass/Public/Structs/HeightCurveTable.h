@@ -0,0 +1,77 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "Curves/CurveFloat.h"
+
+
+/**
+ * A height curve baked into a lookup table over the height map's range (0..1), or another range of the curve's input.
+ * Looking up a value is a lerp between two entries, instead of the key search and interpolation of @see UCurveFloat::GetFloatValue.
+ * Immutable once baked, so all worker threads share one table (@see FTerrainConfiguration::BakeHeightCurve).
+ */
+struct FHeightCurveTable
+{
+public:
+	static const int32 NumEntries = 1024;
+
+protected:
+	/* The curve at MinTime + i / (NumEntries - 1) / TimeScale. */
+	TArray<float> Values;
+
+	float MinTime = 0.0f;
+
+	/* 1 / the length of the range the table covers. */
+	float TimeScale = 1.0f;
+
+public:
+	/**
+	 * Bakes the curve between minTime and maxTime. Inputs outside of that range are clamped to it, like a curve with constant extrapolation.
+	 */
+	explicit FHeightCurveTable(const UCurveFloat& curve, float minTime = 0.0f, float maxTime = 1.0f)
+		: MinTime(minTime), TimeScale(maxTime > minTime ? 1.0f / (maxTime - minTime) : 0.0f)
+	{
+		const float timeStep = (maxTime - minTime) / (float)(NumEntries - 1);
+		Values.SetNumUninitialized(NumEntries);
+		for (int32 i = 0; i < NumEntries; i++)
+		{
+			Values[i] = curve.GetFloatValue(minTime + i * timeStep);
+		}
+	}
+
+	/* Returns the curve's value at the given height. Heights outside of the table's range (0..1 by default) are clamped. */
+	FORCEINLINE float Evaluate(float height) const
+	{
+		int32 index;
+		float alpha;
+		GetSegment(height, index, alpha);
+		return FMath::Lerp(Values[index], Values[index + 1], alpha);
+	}
+
+	/* Returns the curve's value at the given height and the slope of the curve there. */
+	FORCEINLINE float Evaluate(float height, float& outSlope) const
+	{
+		int32 index;
+		float alpha;
+		GetSegment(height, index, alpha);
+		outSlope = (Values[index + 1] - Values[index]) * (NumEntries - 1) * TimeScale;
+		return FMath::Lerp(Values[index], Values[index + 1], alpha);
+	}
+
+	bool operator==(const FHeightCurveTable& other) const
+	{
+		return MinTime == other.MinTime && TimeScale == other.TimeScale && Values == other.Values;
+	}
+
+	/* Compares two (optional) tables by their values. */
+	static bool AreEqual(const FHeightCurveTable* tableA, const FHeightCurveTable* tableB)
+	{
+		return tableA == tableB || (tableA && tableB && *tableA == *tableB);
+	}
+
+private:
+	FORCEINLINE void GetSegment(float height, int32& outIndex, float& outAlpha) const
+	{
+		const float position = FMath::Clamp((height - MinTime) * TimeScale, 0.0f, 1.0f) * (NumEntries - 1);
+		outIndex = FMath::Min(FMath::TruncToInt(position), NumEntries - 2);
+		outAlpha = position - outIndex;
+	}
+};
@@ -0,0 +1,33 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "Array2D.h"
+#include "QuantizedHeightMap.h"
+
+
+/**
+ * The slopes of a height map's noise per sample, padded like the height map (@see UNoiseGenerator::GetNoise2DGridWithDerivatives).
+ * Kept next to a chunk's height map, so that every mesh built from it gets its normals from the same slopes.
+ */
+struct FHeightMapDerivatives
+{
+	FArray2D X;
+	FArray2D Y;
+
+	explicit FHeightMapDerivatives(int32 size) : X(size, size), Y(size, size) {}
+};
+
+/* The slopes of a quantized height map, quantized the same way. @see EHeightMapStorage */
+struct FQuantizedHeightMapDerivatives
+{
+	FQuantizedHeightMap X;
+	FQuantizedHeightMap Y;
+
+	FQuantizedHeightMapDerivatives(const FArray2D& derivativesX, const FArray2D& derivativesY) : X(derivativesX), Y(derivativesY) {}
+
+	/* Decodes the slopes into outX and outY, resizing them if necessary. */
+	void Decode(FArray2D& outX, FArray2D& outY) const
+	{
+		X.Decode(outX);
+		Y.Decode(outY);
+	}
+};
@@ -0,0 +1,75 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "MeshAttributes.generated.h"
+
+
+/* The optional vertex attribute streams of the terrain meshes. The values are bit indices of FTerrainConfiguration::MeshAttributes. */
+UENUM(BlueprintType, meta = (Bitflags))
+enum class EMeshAttribute : uint8
+{
+	Normals,
+	/* Tangents are derived from the normals, so they are only generated along with them. */
+	Tangents,
+	/* The vertex' XY position times the map scale. A material can derive them from the world position instead. */
+	UVs,
+	/* The height in the red channel. A material can derive it from the world position instead. */
+	VertexColors
+};
+
+/* How the mesh normals are calculated when the noise generator doesn't give us its derivatives. */
+UENUM(BlueprintType)
+enum class ENormalQuality : uint8
+{
+	/* The average of the normals of the faces around each vertex. */
+	FaceNormals,
+	/* Central differences of the heights of the neighbouring vertices. A lot faster and slightly smoother. */
+	CentralDifferences
+};
+
+
+/**
+ * Helpers for the vertex attribute mask and the packed attribute formats.
+ */
+struct FMeshAttributes
+{
+	/* A mask with all attributes. */
+	static const int32 All = (1 << 4) - 1;
+
+	static FORCEINLINE bool Has(int32 mask, EMeshAttribute attribute)
+	{
+		return (mask & (1 << (int32)attribute)) != 0;
+	}
+
+	/* Encodes a normalized vector with the octahedron mapping into two 16 bit values. */
+	static FORCEINLINE uint32 PackNormal(const FVector& normal)
+	{
+		const float length = FMath::Abs(normal.X) + FMath::Abs(normal.Y) + FMath::Abs(normal.Z);
+		float u = length > 0.0f ? normal.X / length : 0.0f;
+		float v = length > 0.0f ? normal.Y / length : 0.0f;
+		if (normal.Z < 0.0f)
+		{
+			/* The lower half of the octahedron is folded over the upper one. */
+			const float oldU = u;
+			u = (1.0f - FMath::Abs(v)) * (oldU >= 0.0f ? 1.0f : -1.0f);
+			v = (1.0f - FMath::Abs(oldU)) * (v >= 0.0f ? 1.0f : -1.0f);
+		}
+
+		const int16 packedU = (int16)FMath::RoundToInt(FMath::Clamp(u, -1.0f, 1.0f) * MAX_int16);
+		const int16 packedV = (int16)FMath::RoundToInt(FMath::Clamp(v, -1.0f, 1.0f) * MAX_int16);
+		return (uint32)(uint16)packedU | ((uint32)(uint16)packedV << 16);
+	}
+
+	static FORCEINLINE FVector UnpackNormal(uint32 packedNormal)
+	{
+		const float u = (int16)(packedNormal & 0xFFFF) / (float)MAX_int16;
+		const float v = (int16)(packedNormal >> 16) / (float)MAX_int16;
+
+		FVector normal = FVector(u, v, 1.0f - FMath::Abs(u) - FMath::Abs(v));
+		if (normal.Z < 0.0f)
+		{
+			normal.X = (1.0f - FMath::Abs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+			normal.Y = (1.0f - FMath::Abs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+		}
+		return normal.GetSafeNormal();
+	}
+};
@@ -1,7 +1,9 @@
 #pragma once
 #include "CoreMinimal.h"
 #include "Array2D.h"
-#include "Curves/CurveFloat.h"
+#include "MeshTopology.h"
+#include "MeshAttributes.h"
+#include "HeightCurveTable.h"
 #include "ProceduralMeshComponent.h"
 #include <Kismet/KismetSystemLibrary.h>
 #include <KismetProceduralMeshLibrary.h>
@@ -15,7 +17,9 @@ struct FLinearColor;
 DECLARE_STATS_GROUP(TEXT("MeshData"), STATGROUP_MeshData, STATCAT_Advanced);
 
 DECLARE_CYCLE_STAT(TEXT("CalculateTriangles"), STAT_CalculateTriangles, STATGROUP_MeshData);
+DECLARE_CYCLE_STAT(TEXT("CalculateVertices"), STAT_CalculateVertices, STATGROUP_MeshData);
 DECLARE_CYCLE_STAT(TEXT("CalculateNormals"), STAT_CalculateNormals, STATGROUP_MeshData);
+DECLARE_CYCLE_STAT(TEXT("CalculateNormalsCentralDifferences"), STAT_CalculateNormalsCentralDifferences, STATGROUP_MeshData);
 DECLARE_CYCLE_STAT(TEXT("UpdateMeshData"), STAT_UpdateMeshData, STATGROUP_MeshData);
 
 
@@ -28,25 +32,29 @@ struct FTerrainMeshData
 	GENERATED_BODY()
 
 public:
+	/* The vertex attribute streams. Streams that are not in Attributes are empty. */
 	TArray<FVector> Vertices;
-	TArray<int32> Triangles;
 	TArray<FVector2D> UVs;
 	TArray<FVector> Normals;
 	TArray<FColor> VertexColors;
 	TArray<FProcMeshTangent> Tangents;
 
-	/**
-	 * Contains the indices 
-	 */
-	TArray<int32> VerticesIndexMap;
+	/* The normals, octahedron encoded, instead of Normals when bPackedNormals is set. @see GetNormals */
+	TArray<uint32> PackedNormals;
 
-	/**
-	 * Border vertices are counted from -1 downwards.
-	 * Beginning at the top left, moving row wise.
-	 */ 
-	TArray<FVector> BorderVertices;
-	
-	TArray<int32> BorderTriangles;
+	/* The new vertex heights of a height-only update, instead of Vertices. @see CreateHeightUpdate */
+	TArray<float> Heights;
+
+	/* The attribute streams we have (@see EMeshAttribute). */
+	int32 Attributes = FMeshAttributes::All;
+
+	bool bPackedNormals = false;
+
+	/* How the normals are calculated when there are no height map derivatives. */
+	ENormalQuality NormalQuality = ENormalQuality::FaceNormals;
+
+	/* The triangles. Shared by all mesh data with the same number of vertices. */
+	TSharedPtr<const FTerrainMeshTopology, ESPMode::ThreadSafe> Topology;
 
 	/* The level of detail this mesh data represents. */
 	int32 LOD = 0;
@@ -64,245 +72,510 @@ public:
 	 * Creates a mesh data struct with the given data.
 	 * Safes the height map in the red vertex color channel. This version of the height map is compressed, because the vertex color is only 8 bit (Values in range 0-255).
 	 * The generated mesh data is centered, so the mesh component's central location will be at the mesh's center.
-	 * @param heightMap The height to generate the mesh from. This must be the height map at LOD 0.
-	 * @param borderHeightMap Height values for a ring around the height map that would be at a distance of LOD * 2 (= mesh simplification increment), or at distance 1 in case of
-	 * LOD 0.
+	 * @param heightMap The height to generate the mesh from, padded with heightMapApron samples on every side.
+	 * @param heightMapApron The number of samples around the mesh in the height map. The normals along the edges need the ring of vertices
+	 * just outside of the mesh, so heightMapApron * heightMapStride must be at least the mesh simplification increment (LOD * 2, or 1 for LOD 0),
+	 * unless the derivatives are given.
+	 * @param heightMapStride The distance between two height map samples in mesh units. 1 for a full resolution height map, otherwise
+	 * the mesh simplification increment must be a multiple of it.
+	 * @param heightMapDerivativesX, heightMapDerivativesY Optional slopes of the height map per sample, padded like the height map
+	 * (@see UNoiseGenerator::GetNoise2DLineWithDerivatives). If given, the normals are calculated directly from them, instead of accumulating face normals.
+	 * @param meshAttributes The attribute streams to generate (@see EMeshAttribute). The others are left empty.
+	 * @param bPackNormals Store the normals octahedron encoded in 32 bits.
+	 * @param normalQuality How the normals are calculated if no derivatives are given.
 	 */
-	FTerrainMeshData(const FArray2D& heightMap, float heightMultiplier, int32 levelOfDetail, const TArray<float>& borderHeightMap, const UCurveFloat* heightCurve = nullptr, 
-		float mapScale = 100.0f)
-		: LOD(levelOfDetail), MapScale(mapScale)
+	FTerrainMeshData(const FArray2D& heightMap, int32 heightMapApron, int32 heightMapStride, float heightMultiplier, int32 levelOfDetail, const FHeightCurveTable* heightCurve = nullptr, 
+		float mapScale = 100.0f, const FArray2D* heightMapDerivativesX = nullptr, const FArray2D* heightMapDerivativesY = nullptr, 
+		int32 meshAttributes = FMeshAttributes::All, bool bPackNormals = false, ENormalQuality normalQuality = ENormalQuality::FaceNormals)
+		: Attributes(meshAttributes), bPackedNormals(bPackNormals), NormalQuality(normalQuality), LOD(levelOfDetail), MapScale(mapScale)
 	{
-		const int32 heightMapWidth = heightMap.GetWidth();
+		const bool bHasNormals = HasAttribute(EMeshAttribute::Normals);
+		const bool bNormalsFromDerivatives = heightMapDerivativesX && heightMapDerivativesY;
+		const int32 meshSize = GetMeshSize(heightMap, heightMapApron, heightMapStride);
 		const int32 meshSimplificationIncrement = LOD == 0 ? 1 : LOD * 2;
-		const int32 verticesPerLine = (heightMapWidth - 1) / meshSimplificationIncrement + 1;
-		const int32 borderVerticesPerLine = verticesPerLine + 2;
-		const int32 numVertices = FMath::Pow(verticesPerLine, 2); /* Total number of vertices of the entire mesh (without border). */
-		const int32 numBorderVertices = (verticesPerLine * 4 + 4); /* Total number of border vertices. */
+		const int32 verticesPerLine = (meshSize - 1) / meshSimplificationIncrement + 1;
+		const int32 numVertices = verticesPerLine * verticesPerLine;
 
 		Vertices.SetNum(numVertices);
-		Normals.SetNum(numVertices);
-		Tangents.SetNum(numVertices);
-		Triangles.SetNum((verticesPerLine - 1) * (verticesPerLine - 1) * 6);
-		UVs.SetNum(numVertices);
-		VertexColors.SetNum(numVertices);
-		VerticesIndexMap.SetNum(borderVerticesPerLine * borderVerticesPerLine);
-		BorderVertices.SetNum(numBorderVertices);
-		BorderTriangles.SetNum(24 * borderVerticesPerLine);
-		
-		/* Initialize the vertices index map. The vertices index map contains the indices for all vertices (mesh and border).
-		 * This is necessary to easily get the correct vertex index based on a x and y coordinate, where 0,0 would be the top left
-		 * corner of the border and translates to the vertex index -1 for the first border vertex, while the x,y coordinates 1,1 would
-		 * be the vertex index 0 for the first non-birder vertex. */
-		{ 
-			int32 meshVertexIndex = 0;
-			int32 borderVertexIndex = -1;
-			for (int32 y = 0; y < borderVerticesPerLine; ++y)
+		if (bHasNormals)
+		{
+			bPackedNormals ? PackedNormals.SetNum(numVertices) : Normals.SetNum(numVertices);
+		}
+		if (bHasNormals && HasAttribute(EMeshAttribute::Tangents))
+		{
+			Tangents.SetNum(numVertices);
+		}
+		if (HasAttribute(EMeshAttribute::UVs))
+		{
+			UVs.SetNum(numVertices);
+		}
+		if (HasAttribute(EMeshAttribute::VertexColors))
+		{
+			VertexColors.SetNum(numVertices);
+		}
+		Topology = FTerrainMeshTopology::Get(verticesPerLine);
+
+		/* Calculate vertices and UVs. */
+		{
+			SCOPE_CYCLE_COUNTER(STAT_CalculateVertices);
+
+			for (int32 y = 0; y < verticesPerLine; ++y)
 			{
-				for (int32 x = 0; x < borderVerticesPerLine; ++x)
+				for (int32 x = 0; x < verticesPerLine; ++x)
 				{
-					const int32 index = x + y * borderVerticesPerLine;
-
-					const bool bIsBorderVertex = y == 0 || y == borderVerticesPerLine - 1 || x == 0 || x == borderVerticesPerLine - 1;
-					if (bIsBorderVertex)
-					{
-						VerticesIndexMap[index] = borderVertexIndex;
-						borderVertexIndex--;
-					}
-					else
+					const int32 vertexIndex = x + y * verticesPerLine;
+					SetVertexAndUV(x, y, vertexIndex, heightMap, heightMapApron, heightMapStride, heightMultiplier, heightCurve);
+					if (bHasNormals && bNormalsFromDerivatives)
 					{
-						VerticesIndexMap[index] = meshVertexIndex;
-						meshVertexIndex++;
+						SetNormalFromDerivatives(x, y, vertexIndex, heightMap, heightMapApron, heightMapStride, *heightMapDerivativesX, *heightMapDerivativesY, heightMultiplier, heightCurve);
 					}
 				}
 			}
 		}
 
-		int32 triangleIndex = 0;
-		int32 borderTriangleIndex = 0;
-
-		/* Adds a triangle to the triangle array (all indices positive) or
-		 * border triangle array (any index smaller 0). */
-		auto AddTriangle = [&](int32 a, int32 b, int32 c)
+		if (bHasNormals && !bNormalsFromDerivatives)
 		{
-			if (a >= 0 && b >= 0 && c >= 0)
-			{
-				Triangles[triangleIndex] = a;
-				Triangles[triangleIndex + 1] = b;
-				Triangles[triangleIndex + 2] = c;
-				triangleIndex += 3;
-			}
-			else
-			{
-				BorderTriangles[borderTriangleIndex] = a;
-				BorderTriangles[borderTriangleIndex + 1] = b;
-				BorderTriangles[borderTriangleIndex + 2] = c;
-				borderTriangleIndex += 3;
-			}
-		};
+			CalculateNormals(heightMap, heightMapApron, heightMapStride, heightMultiplier, heightCurve);
+		}
+	}
+
+	~FTerrainMeshData() {}
+
+	FORCEINLINE const TArray<int32>& GetTriangles() const
+	{
+		check(Topology.IsValid());
+		return Topology->Triangles;
+	}
 
-		/* Calculate triangles, vertices and UVs. */
-		for (int32 y = 0; y < borderVerticesPerLine; ++y)
+	FORCEINLINE bool HasAttribute(EMeshAttribute attribute) const
+	{
+		return FMeshAttributes::Has(Attributes, attribute);
+	}
+
+	/* Returns the normals. Packed normals are decoded into unpackedNormals for that. */
+	const TArray<FVector>& GetNormals(TArray<FVector>& unpackedNormals) const
+	{
+		if (!bPackedNormals)
 		{
-			SCOPE_CYCLE_COUNTER(STAT_CalculateTriangles);
+			return Normals;
+		}
 
-			for (int32 x = 0; x < borderVerticesPerLine; ++x)
-			{
-				const int32 vertexIndex = VerticesIndexMap[x + y * borderVerticesPerLine];
-				SetVertexAndUV(x, y, vertexIndex, heightMap, heightMultiplier, borderHeightMap, heightCurve);
+		unpackedNormals.SetNumUninitialized(PackedNormals.Num());
+		for (int32 i = 0; i < PackedNormals.Num(); i++)
+		{
+			unpackedNormals[i] = FMeshAttributes::UnpackNormal(PackedNormals[i]);
+		}
+		return unpackedNormals;
+	}
 
-				if (vertexIndex >= 0)
-				{
-					/* We need to initialize the normals array, because all normal vectors has to be exactly 0,
-					 * when we start to calculate them. */
-					Normals[vertexIndex] = FVector::ZeroVector;
-				}
+	/* Sets the normal of a vertex and the tangent derived from it, for the streams we have. */
+	FORCEINLINE void SetNormalAndTangent(int32 vertexIndex, const FVector& normal)
+	{
+		if (bPackedNormals)
+		{
+			PackedNormals[vertexIndex] = FMeshAttributes::PackNormal(normal);
+		}
+		else
+		{
+			Normals[vertexIndex] = normal;
+		}
 
-				if (x < borderVerticesPerLine - 1 && y < borderVerticesPerLine - 1)
-				{
-					const int32 a = VerticesIndexMap[x + y * borderVerticesPerLine];
-					const int32 b = VerticesIndexMap[(x + 1) + (y * borderVerticesPerLine)];
-					const int32 c = VerticesIndexMap[x + ((y + 1) * borderVerticesPerLine)];
-					const int32 d = VerticesIndexMap[(x + 1) + ((y + 1) * borderVerticesPerLine)];
-					AddTriangle(a, c, d);
-					AddTriangle(a, d, b);
-				}
-			}
+		if (Tangents.Num() > 0)
+		{
+			const bool bFlipBitangent = normal.Z < 0.0f;
+			Tangents[vertexIndex] = FProcMeshTangent(normal, bFlipBitangent);
 		}
+	}
 
-		{ /* Calculate normals. */
-			SCOPE_CYCLE_COUNTER(STAT_CalculateNormals);
+	/* Returns the size of the mesh (without the apron) that the height map covers, in mesh units. */
+	static FORCEINLINE int32 GetMeshSize(const FArray2D& heightMap, int32 heightMapApron, int32 heightMapStride)
+	{
+		return (heightMap.GetWidth() - 2 * heightMapApron - 1) * heightMapStride + 1;
+	}
 
-			/**
-			 * Calculates a normal vector from three vertex indices.
-			 * When an index is less than zero, than this is a border vertex.
-			 */ 
-			auto NormalFromVertices = [&](int32 indexA, int32 indexB, int32 indexC) -> FVector
-			{
-				const FVector pointA = indexA >= 0 ? Vertices[indexA] : BorderVertices[-indexA - 1];
-				const FVector pointB = indexB >= 0 ? Vertices[indexB] : BorderVertices[-indexB - 1];
-				const FVector pointC = indexC >= 0 ? Vertices[indexC] : BorderVertices[-indexC - 1];
+	/**
+	 * Returns the position of the vertex that is xPos, yPos mesh units away from the mesh's top left corner.
+	 * The position may be outside of the mesh, as long as it is within the height map's apron. It must be a multiple of the height map stride.
+	 * @param outHeight The height map value (after the height curve) at that position.
+	 */
+	FORCEINLINE FVector GetVertexPosition(int32 xPos, int32 yPos, const FArray2D& heightMap, int32 heightMapApron, int32 heightMapStride, float heightMultiplier, 
+		const FHeightCurveTable* heightCurve, float& outHeight) const
+	{
+		const float topLeft = (GetMeshSize(heightMap, heightMapApron, heightMapStride) - 1) / -2.0f;
 
-				const FVector sideAC = pointC - pointA;
-				const FVector sideAB = pointB - pointA;
+		const float height = heightMap.GetValue(heightMapApron + xPos / heightMapStride, heightMapApron + yPos / heightMapStride);
+		outHeight = heightCurve ? height * heightCurve->Evaluate(height) : height;
+		return FVector(topLeft + xPos, topLeft + yPos, outHeight * heightMultiplier);
+	}
 
-				FVector triangleNormal = FVector::CrossProduct(sideAC, sideAB);
-				triangleNormal.Normalize();
-				return triangleNormal;
-			};
+	void SetVertexAndUV(int32 x, int32 y, int32 vertexIndex, const FArray2D& heightMap, int32 heightMapApron, int32 heightMapStride, float heightMultiplier, 
+		const FHeightCurveTable* heightCurve = nullptr)
+	{
+		const int32 meshSize = GetMeshSize(heightMap, heightMapApron, heightMapStride);
+		const int32 meshSimplificationIncrement = LOD == 0 ? 1 : LOD * 2;
+		const int32 xPos = x * meshSimplificationIncrement;
+		const int32 yPos = y * meshSimplificationIncrement;
 
-			/* Mesh normals */
-			const int32 triangleCount = Triangles.Num() / 3;
-			for (int32 i = 0; i < triangleCount; i++)
-			{
-				const int32 normalTriangleIndex = i * 3;
-				const int32 vertexIndexA = Triangles[normalTriangleIndex];
-				const int32 vertexIndexB = Triangles[normalTriangleIndex + 1];
-				const int32 vertexIndexC = Triangles[normalTriangleIndex + 2];
-
-				const FVector triangleNormal = NormalFromVertices(vertexIndexA, vertexIndexB, vertexIndexC);
-
-				/* We add the normals together (and normalize it later), because a vertex normal is the average
-				 * normal across it's connected faces */
-				Normals[vertexIndexA] += triangleNormal;
-				Normals[vertexIndexB] += triangleNormal;
-				Normals[vertexIndexC] += triangleNormal;
-			}
+		float height = 0.0f;
+		const FVector vertexPosition = GetVertexPosition(xPos, yPos, heightMap, heightMapApron, heightMapStride, heightMultiplier, heightCurve, height);
 
-			/* Border normals */
-			const int32 borderTrianglesCount = BorderTriangles.Num() / 3;
-			for (int32 i = 0; i < borderTrianglesCount; i++)
-			{
-				const int32 normalTriangleIndex = i * 3;
-				const int32 vertexIndexA = BorderTriangles[normalTriangleIndex];
-				const int32 vertexIndexB = BorderTriangles[normalTriangleIndex + 1];
-				const int32 vertexIndexC = BorderTriangles[normalTriangleIndex + 2];
+		Vertices[vertexIndex] = vertexPosition;
+		if (UVs.Num() > 0)
+		{
+			UVs[vertexIndex] = (FVector2D(vertexPosition.X, vertexPosition.Y) * MapScale) / (float)(meshSize);
+		}
+
+		if (VertexColors.Num() > 0)
+		{
+			/* Safe the height map to the red vertex color channel. */
+			float mappedHeight = FMath::GetMappedRangeValueClamped(FVector2D(0.0f, 1.0f), FVector2D(0.0f, 255.0f), height);
+			VertexColors[vertexIndex] = FColor(FMath::RoundToInt(mappedHeight), 0, 0);
+		}
+	}
+
+	/* Calculates the normals and tangents from the height map, the way our NormalQuality says. */
+	FORCEINLINE void CalculateNormals(const FArray2D& heightMap, int32 heightMapApron, int32 heightMapStride, float heightMultiplier, const FHeightCurveTable* heightCurve = nullptr)
+	{
+		if (NormalQuality == ENormalQuality::CentralDifferences)
+		{
+			CalculateNormalsFromCentralDifferences(heightMap, heightMapApron, heightMapStride, heightMultiplier, heightCurve);
+		}
+		else
+		{
+			CalculateFaceNormals(heightMap, heightMapApron, heightMapStride, heightMultiplier, heightCurve);
+		}
+	}
+
+	/**
+	 * Calculates the normals and tangents by accumulating the face normals around each vertex.
+	 * The vertices are laid out with a ring of vertices from the height map's apron around them, so the edge vertices get
+	 * the faces of the neighbouring chunk as well and every vertex is handled the same way.
+	 */
+	void CalculateFaceNormals(const FArray2D& heightMap, int32 heightMapApron, int32 heightMapStride, float heightMultiplier, const FHeightCurveTable* heightCurve = nullptr)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_CalculateNormals);
+
+		const int32 meshSimplificationIncrement = LOD == 0 ? 1 : LOD * 2;
+		if (heightMapApron * heightMapStride < meshSimplificationIncrement)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Height map apron %d is too small for LOD %d. Normals will be missing."), heightMapApron, LOD);
+			return;
+		}
 
-				const FVector triangleNormal = NormalFromVertices(vertexIndexA, vertexIndexB, vertexIndexC);
+		const int32 meshSize = GetMeshSize(heightMap, heightMapApron, heightMapStride);
+		const int32 verticesPerLine = (meshSize - 1) / meshSimplificationIncrement + 1;
+		const int32 paddedVerticesPerLine = verticesPerLine + 2;
 
-				/* When a vertex index is negative, it's a border vertex, for which we don't safe the normals. */
-				if (vertexIndexA >= 0)
+		/* The mesh vertices, with the ring around them. */
+		TArray<FVector> paddedVertices; paddedVertices.SetNumUninitialized(paddedVerticesPerLine * paddedVerticesPerLine);
+		float height = 0.0f;
+		for (int32 y = 0; y < paddedVerticesPerLine; ++y)
+		{
+			const bool bIsRingRow = y == 0 || y == paddedVerticesPerLine - 1;
+			const int32 yPos = (y - 1) * meshSimplificationIncrement;
+			FVector* row = paddedVertices.GetData() + y * paddedVerticesPerLine;
+			if (bIsRingRow)
+			{
+				for (int32 x = 0; x < paddedVerticesPerLine; ++x)
 				{
-					Normals[vertexIndexA] += triangleNormal;
+					row[x] = GetVertexPosition((x - 1) * meshSimplificationIncrement, yPos, heightMap, heightMapApron, heightMapStride, heightMultiplier, heightCurve, height);
 				}
-				if (vertexIndexB >= 0)
+			}
+			else
+			{
+				row[0] = GetVertexPosition(-meshSimplificationIncrement, yPos, heightMap, heightMapApron, heightMapStride, heightMultiplier, heightCurve, height);
+				if (Vertices.Num() > 0)
 				{
-					Normals[vertexIndexB] += triangleNormal;
+					FMemory::Memcpy(row + 1, Vertices.GetData() + (y - 1) * verticesPerLine, verticesPerLine * sizeof(FVector));
 				}
-				if (vertexIndexC >= 0)
+				else
 				{
-					Normals[vertexIndexC] += triangleNormal;
+					/* A height-only update only has the heights. */
+					const float topLeft = (meshSize - 1) / -2.0f;
+					const float* rowHeights = Heights.GetData() + (y - 1) * verticesPerLine;
+					for (int32 x = 0; x < verticesPerLine; ++x)
+					{
+						row[x + 1] = FVector(topLeft + x * meshSimplificationIncrement, topLeft + yPos, rowHeights[x]);
+					}
 				}
+				row[paddedVerticesPerLine - 1] = GetVertexPosition(meshSize - 1 + meshSimplificationIncrement, yPos, heightMap, heightMapApron, heightMapStride, heightMultiplier, heightCurve, height);
 			}
+		}
+
+		/* We add the face normals together (and normalize them later), because a vertex normal is the average
+		 * normal across it's connected faces. */
+		TArray<FVector> paddedNormals; paddedNormals.SetNumZeroed(paddedVerticesPerLine * paddedVerticesPerLine);
+		auto AddFaceNormal = [&](int32 indexA, int32 indexB, int32 indexC)
+		{
+			const FVector sideAC = paddedVertices[indexC] - paddedVertices[indexA];
+			const FVector sideAB = paddedVertices[indexB] - paddedVertices[indexA];
+			const FVector triangleNormal = FVector::CrossProduct(sideAC, sideAB).GetSafeNormal();
+			paddedNormals[indexA] += triangleNormal;
+			paddedNormals[indexB] += triangleNormal;
+			paddedNormals[indexC] += triangleNormal;
+		};
 
-			/* Normalize the normals and generate mesh tangents. */
-			for (int32 i = 0; i < numVertices; i++)
+		for (int32 y = 0; y < paddedVerticesPerLine - 1; ++y)
+		{
+			for (int32 x = 0; x < paddedVerticesPerLine - 1; ++x)
 			{
-				Normals[i].Normalize();
+				const int32 a = x + y * paddedVerticesPerLine;
+				const int32 b = a + 1;
+				const int32 c = a + paddedVerticesPerLine;
+				const int32 d = c + 1;
+				AddFaceNormal(a, c, d);
+				AddFaceNormal(a, d, b);
+			}
+		}
 
-				const bool bFlipBitangent = Normals[i].Z < 0.0f;
-				Tangents[i] = FProcMeshTangent(Normals[i], bFlipBitangent);
+		/* Normalize the normals of the mesh vertices and generate mesh tangents. */
+		for (int32 y = 0; y < verticesPerLine; ++y)
+		{
+			for (int32 x = 0; x < verticesPerLine; ++x)
+			{
+				SetNormalAndTangent(x + y * verticesPerLine, paddedNormals[(x + 1) + (y + 1) * paddedVerticesPerLine].GetSafeNormal());
 			}
 		}
 	}
 
-	~FTerrainMeshData() {}
-
-	void SetVertexAndUV(int32 x, int32 y, int32 vertexIndex, const FArray2D& heightMap, float heightMultiplier, const TArray<float>& borderHeightMap, 
-		const UCurveFloat* heightCurve = nullptr)
+	/**
+	 * Calculates the normals and tangents from the central differences of the vertex heights: the slope at a vertex is the height difference
+	 * of its left and right (top and bottom) neighbours over their distance. The neighbours of the edge vertices come from the height map's apron.
+	 * The heights are gathered into a padded grid first, the normals are then calculated four at a time without any branches.
+	 */
+	void CalculateNormalsFromCentralDifferences(const FArray2D& heightMap, int32 heightMapApron, int32 heightMapStride, float heightMultiplier, 
+		const FHeightCurveTable* heightCurve = nullptr)
 	{
-		const int32 meshSize = heightMap.GetWidth();
-		const float topLeftX = (meshSize - 1) / -2.0f;
-		const float topLeftY = (meshSize - 1) / -2.0f;
+		SCOPE_CYCLE_COUNTER(STAT_CalculateNormalsCentralDifferences);
 
 		const int32 meshSimplificationIncrement = LOD == 0 ? 1 : LOD * 2;
-		const int32 xPos = (x - 1) * meshSimplificationIncrement;
-		const int32 yPos = (y - 1) * meshSimplificationIncrement;
+		if (heightMapApron * heightMapStride < meshSimplificationIncrement)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Height map apron %d is too small for LOD %d. Normals will be missing."), heightMapApron, LOD);
+			return;
+		}
+
+		const int32 meshSize = GetMeshSize(heightMap, heightMapApron, heightMapStride);
+		const int32 verticesPerLine = (meshSize - 1) / meshSimplificationIncrement + 1;
+		const int32 sampleStep = meshSimplificationIncrement / heightMapStride;
 
-		float height = 0;
-		if (vertexIndex >= 0)
+		/* The vertex heights with a ring around them. The rows are long enough for the last block of four to read past the ring. */
+		const int32 paddedVerticesPerLine = verticesPerLine + 2;
+		const int32 rowPitch = Align(verticesPerLine, 4) + 4;
+		TArray<float, TAlignedHeapAllocator<16>> heights; heights.SetNumZeroed(rowPitch * paddedVerticesPerLine);
+		const int32 firstSample = heightMapApron - sampleStep;
+		for (int32 y = 0; y < paddedVerticesPerLine; ++y)
 		{
-			height = heightMap.GetValue(xPos, yPos);
+			const float* RESTRICT sourceRow = heightMap.GetRow(firstSample + y * sampleStep) + firstSample;
+			float* RESTRICT row = heights.GetData() + y * rowPitch;
+			for (int32 x = 0; x < paddedVerticesPerLine; ++x)
+			{
+				const float height = sourceRow[x * sampleStep];
+				row[x] = (heightCurve ? height * heightCurve->Evaluate(height) : height) * heightMultiplier;
+			}
 		}
-		else
+
+		/* normal = normalize(-dz/dx, -dz/dy, 1) */
+		const int32 blockLength = Align(verticesPerLine, 4);
+		TArray<float, TAlignedHeapAllocator<16>> normalsX; normalsX.SetNumUninitialized(blockLength);
+		TArray<float, TAlignedHeapAllocator<16>> normalsY; normalsY.SetNumUninitialized(blockLength);
+		TArray<float, TAlignedHeapAllocator<16>> normalsZ; normalsZ.SetNumUninitialized(blockLength);
+		const VectorRegister negativeInverseDistance = VectorSetFloat1(-1.0f / (2.0f * meshSimplificationIncrement));
+		for (int32 y = 0; y < verticesPerLine; ++y)
 		{
-			height = borderHeightMap[-vertexIndex - 1];
+			const float* above = heights.GetData() + y * rowPitch + 1;
+			const float* center = heights.GetData() + (y + 1) * rowPitch;
+			const float* below = heights.GetData() + (y + 2) * rowPitch + 1;
+			for (int32 x = 0; x < blockLength; x += 4)
+			{
+				const VectorRegister slopeX = VectorMultiply(VectorSubtract(VectorLoad(center + x + 2), VectorLoad(center + x)), negativeInverseDistance);
+				const VectorRegister slopeY = VectorMultiply(VectorSubtract(VectorLoad(below + x), VectorLoad(above + x)), negativeInverseDistance);
+				const VectorRegister lengthSquared = VectorMultiplyAdd(slopeX, slopeX, VectorMultiplyAdd(slopeY, slopeY, VectorOne()));
+				const VectorRegister inverseLength = VectorReciprocalSqrtAccurate(lengthSquared);
+				VectorStoreAligned(VectorMultiply(slopeX, inverseLength), normalsX.GetData() + x);
+				VectorStoreAligned(VectorMultiply(slopeY, inverseLength), normalsY.GetData() + x);
+				VectorStoreAligned(inverseLength, normalsZ.GetData() + x);
+			}
+
+			for (int32 x = 0; x < verticesPerLine; ++x)
+			{
+				SetNormalAndTangent(x + y * verticesPerLine, FVector(normalsX[x], normalsY[x], normalsZ[x]));
+			}
 		}
+	}
 
-		const float curveValue = heightCurve ? heightCurve->GetFloatValue(height) : 1.0f;
-		const float totalHeight = height * heightMultiplier * curveValue;		
-		const FVector vertexPosition = FVector((topLeftX + xPos), (topLeftY + yPos), totalHeight);
+	/**
+	 * Sets the normal and tangent of a mesh vertex from the slope of the height map at that vertex.
+	 * The vertex height is height * heightMultiplier * curve(height), so its slope is the height map slope times the derivative of that.
+	 * The mesh is one unit per height map sample, so the slope can be used as is.
+	 */
+	void SetNormalFromDerivatives(int32 x, int32 y, int32 vertexIndex, const FArray2D& heightMap, int32 heightMapApron, int32 heightMapStride, const FArray2D& heightMapDerivativesX, 
+		const FArray2D& heightMapDerivativesY, float heightMultiplier, const FHeightCurveTable* heightCurve = nullptr)
+	{
+		const int32 meshSimplificationIncrement = LOD == 0 ? 1 : LOD * 2;
+		const int32 xPos = heightMapApron + x * meshSimplificationIncrement / heightMapStride;
+		const int32 yPos = heightMapApron + y * meshSimplificationIncrement / heightMapStride;
+
+		const float height = heightMap.GetValue(xPos, yPos);
 
-		if(vertexIndex >= 0)
+		float heightScale = heightMultiplier;
+		if (heightCurve)
 		{
-			Vertices[vertexIndex] = vertexPosition;
-			UVs[vertexIndex] = (FVector2D(topLeftX + xPos, topLeftY + yPos) * MapScale) / (float)(meshSize);
+			float curveSlope = 0.0f;
+			const float curveValue = heightCurve->Evaluate(height, curveSlope);
+			heightScale *= curveValue + height * curveSlope;
+		}
 
-			/* Safe the height map to the red vertex color channel. */
-			float mappedHeight = FMath::GetMappedRangeValueClamped(FVector2D(0.0f, 1.0f), FVector2D(0.0f, 255.0f), height * curveValue);
-			VertexColors[vertexIndex] = FColor(FMath::RoundToInt(mappedHeight), 0, 0);
+		const FVector normal = FVector(-heightMapDerivativesX.GetValue(xPos, yPos) * heightScale, -heightMapDerivativesY.GetValue(xPos, yPos) * heightScale, 1.0f).GetSafeNormal();
+		SetNormalAndTangent(vertexIndex, normal);
+	}
+
+	/**
+	 * Creates the mesh data for a height-only update of an existing mesh, for a new height map, multiplier or height curve when everything
+	 * else (size, LOD, scale, attributes) stays the same. It only has the vertex heights (@see Heights), vertex colors, normals and tangents,
+	 * the XY positions, UVs and triangles don't change with the heights. @see TakeHeightsFrom
+	 * The parameters are the same as the constructor's.
+	 */
+	static FTerrainMeshData* CreateHeightUpdate(const FArray2D& heightMap, int32 heightMapApron, int32 heightMapStride, float heightMultiplier, int32 levelOfDetail, 
+		const FHeightCurveTable* heightCurve, const FArray2D* heightMapDerivativesX, const FArray2D* heightMapDerivativesY, int32 meshAttributes, bool bPackNormals, 
+		ENormalQuality normalQuality)
+	{
+		FTerrainMeshData* meshData = new FTerrainMeshData();
+		meshData->Attributes = meshAttributes;
+		meshData->bPackedNormals = bPackNormals;
+		meshData->NormalQuality = normalQuality;
+		meshData->LOD = levelOfDetail;
+
+		const int32 meshSize = GetMeshSize(heightMap, heightMapApron, heightMapStride);
+		const int32 meshSimplificationIncrement = levelOfDetail == 0 ? 1 : levelOfDetail * 2;
+		const int32 verticesPerLine = (meshSize - 1) / meshSimplificationIncrement + 1;
+		const int32 numVertices = verticesPerLine * verticesPerLine;
+		const bool bHasNormals = meshData->HasAttribute(EMeshAttribute::Normals);
+		meshData->Heights.SetNumUninitialized(numVertices);
+		if (bHasNormals)
+		{
+			bPackNormals ? meshData->PackedNormals.SetNum(numVertices) : meshData->Normals.SetNum(numVertices);
 		}
-		else
+		if (bHasNormals && meshData->HasAttribute(EMeshAttribute::Tangents))
+		{
+			meshData->Tangents.SetNum(numVertices);
+		}
+		if (meshData->HasAttribute(EMeshAttribute::VertexColors))
 		{
-			BorderVertices[-vertexIndex-1] = vertexPosition;
+			meshData->VertexColors.SetNum(numVertices);
 		}
+
+		meshData->UpdateHeights(heightMap, heightMapApron, heightMapStride, heightMultiplier, heightCurve, heightMapDerivativesX, heightMapDerivativesY);
+		return meshData;
 	}
 
-	void UpdateMeshData(const FArray2D& heightMap, float heightMultiplier, const TArray<float>& borderHeightMap, const UCurveFloat* heightCurve = nullptr)
+	/**
+	 * Takes over a height-only update (@see CreateHeightUpdate): only the Z of the vertices is rewritten, in place. The vertex colors,
+	 * normals and tangents are taken over as they are.
+	 * @return False if the update doesn't fit this mesh anymore, then nothing is changed.
+	 */
+	bool TakeHeightsFrom(FTerrainMeshData& heightUpdate)
+	{
+		if (heightUpdate.LOD != LOD || heightUpdate.Attributes != Attributes || heightUpdate.bPackedNormals != bPackedNormals 
+			|| heightUpdate.Heights.Num() != Vertices.Num())
+		{
+			return false;
+		}
+
+		FVector* RESTRICT vertices = Vertices.GetData();
+		const float* RESTRICT heights = heightUpdate.Heights.GetData();
+		for (int32 i = 0; i < Vertices.Num(); i++)
+		{
+			vertices[i].Z = heights[i];
+		}
+		Normals = MoveTemp(heightUpdate.Normals);
+		PackedNormals = MoveTemp(heightUpdate.PackedNormals);
+		Tangents = MoveTemp(heightUpdate.Tangents);
+		VertexColors = MoveTemp(heightUpdate.VertexColors);
+		return true;
+	}
+
+	/**
+	 * Writes the heights, vertex colors, normals and tangents for the height map. The streams must have the right size already.
+	 * The normals come from the derivatives if given, otherwise they are calculated from the new heights. @see CalculateNormals
+	 */
+	void UpdateHeights(const FArray2D& heightMap, int32 heightMapApron, int32 heightMapStride, float heightMultiplier, const FHeightCurveTable* heightCurve = nullptr, 
+		const FArray2D* heightMapDerivativesX = nullptr, const FArray2D* heightMapDerivativesY = nullptr)
 	{
 		SCOPE_CYCLE_COUNTER(STAT_UpdateMeshData);
 
-		const int32 heightMapWidth = heightMap.GetWidth();
+		const int32 meshSize = GetMeshSize(heightMap, heightMapApron, heightMapStride);
 		const int32 meshSimplificationIncrement = LOD == 0 ? 1 : LOD * 2;
-		const int32 verticesPerLine = (heightMapWidth - 1) / meshSimplificationIncrement + 1;
-		const int32 borderVerticesPerLine = verticesPerLine + 2;
+		const int32 verticesPerLine = (meshSize - 1) / meshSimplificationIncrement + 1;
+		const int32 sampleStep = meshSimplificationIncrement / heightMapStride;
+		if (Heights.Num() != verticesPerLine * verticesPerLine)
+		{
+			UE_LOG(LogTemp, Error, TEXT("Height map doesn't match the mesh of LOD %d."), LOD);
+			return;
+		}
+
+		/* One row at a time: gather the (curved) heights, scale them four at a time and write them into Heights. */
+		const int32 rowLength = Align(verticesPerLine, 4);
+		TArray<float, TAlignedHeapAllocator<16>> heights; heights.SetNumZeroed(rowLength);
+		TArray<float, TAlignedHeapAllocator<16>> vertexHeights; vertexHeights.SetNumZeroed(rowLength);
+		const VectorRegister multiplier = VectorSetFloat1(heightMultiplier);
+		for (int32 y = 0; y < verticesPerLine; ++y)
+		{
+			const float* RESTRICT sourceRow = heightMap.GetRow(heightMapApron + y * sampleStep) + heightMapApron;
+			float* RESTRICT rowHeights = heights.GetData();
+			float* RESTRICT rowVertexHeights = vertexHeights.GetData();
+			if (heightCurve)
+			{
+				for (int32 x = 0; x < verticesPerLine; ++x)
+				{
+					const float height = sourceRow[x * sampleStep];
+					rowHeights[x] = height * heightCurve->Evaluate(height);
+				}
+			}
+			else
+			{
+				for (int32 x = 0; x < verticesPerLine; ++x)
+				{
+					rowHeights[x] = sourceRow[x * sampleStep];
+				}
+			}
 
-		for (int32 y = 0; y < borderVerticesPerLine; ++y)
+			for (int32 x = 0; x < rowLength; x += 4)
+			{
+				VectorStoreAligned(VectorMultiply(VectorLoadAligned(rowHeights + x), multiplier), rowVertexHeights + x);
+			}
+
+			FMemory::Memcpy(Heights.GetData() + y * verticesPerLine, rowVertexHeights, verticesPerLine * sizeof(float));
+
+			if (VertexColors.Num() > 0)
+			{
+				/* Safe the height map to the red vertex color channel. */
+				FColor* RESTRICT rowColors = VertexColors.GetData() + y * verticesPerLine;
+				for (int32 x = 0; x < verticesPerLine; ++x)
+				{
+					rowColors[x] = FColor(FMath::RoundToInt(FMath::Clamp(rowHeights[x], 0.0f, 1.0f) * 255.0f), 0, 0);
+				}
+			}
+		}
+
+		if (!HasAttribute(EMeshAttribute::Normals))
+		{
+			return;
+		}
+		if (heightMapDerivativesX && heightMapDerivativesY)
 		{
-			for (int32 x = 0; x < borderVerticesPerLine; ++x)
+			for (int32 y = 0; y < verticesPerLine; ++y)
 			{
-				const int32 vertexIndex = VerticesIndexMap[x + y * borderVerticesPerLine];
-				SetVertexAndUV(x, y, vertexIndex, heightMap, heightMultiplier, borderHeightMap, heightCurve);
+				for (int32 x = 0; x < verticesPerLine; ++x)
+				{
+					SetNormalFromDerivatives(x, y, x + y * verticesPerLine, heightMap, heightMapApron, heightMapStride, *heightMapDerivativesX, *heightMapDerivativesY, 
+						heightMultiplier, heightCurve);
+				}
 			}
 		}
+		else
+		{
+			CalculateNormals(heightMap, heightMapApron, heightMapStride, heightMultiplier, heightCurve);
+		}
 	}
-};
\ No newline at end of file
+};
@@ -2,6 +2,7 @@
 #include "CoreMinimal.h"
 #include "TerrainChunk.h"
 #include "TerrainConfiguration.h"
+#include "NoiseOrigin.h"
 #include "MeshDataJob.generated.h"
 
 
@@ -32,36 +33,103 @@ public:
 	/* For which level of detail the mesh data will be generated. */
 	int32 LevelOfDetail = 0;
 
-	/* Do we want to update the mesh section or create a new one? */
+	/* Do we want to update the mesh section or create a new one?
+	 * Updates only change the heights of all of the chunk's meshes. @see FTerrainMeshData::CreateHeightUpdate */
 	bool bUpdateMeshSection = false;
 
-	/* Add this offset to the noise generator input and to the uv coordinates. */
-	FVector2D Offset = FVector2D::ZeroVector;
+	/* The LODs the chunk had meshes for when this update job was created. */
+	TArray<int32> UpdatedLODs;
+
+	/* Does an update have to generate the height map again, or only apply amplitude and height curve to the cached one? */
+	bool bRegenerateHeightMap = true;
+
+	/* The chunk's position in noise space. The height map is sampled relative to it. */
+	FNoiseOrigin NoiseOrigin;
+
+	/* The configuration this job was created with. @see FTerrainConfigurationSnapshot */
+	TSharedPtr<const FTerrainConfigurationSnapshot, ESPMode::ThreadSafe> Snapshot;
+
+	/* The chunk's height map and its layout when this job was created. The worker only ever reads the chunk's height map through
+	 * these, the game thread may replace the chunk's one at any time. */
+	TSharedPtr<const FArray2D, ESPMode::ThreadSafe> SourceHeightMap;
+	TSharedPtr<const FQuantizedHeightMap, ESPMode::ThreadSafe> SourceQuantizedHeightMap;
+	TSharedPtr<const FHeightMapDerivatives, ESPMode::ThreadSafe> SourceHeightMapDerivatives;
+	TSharedPtr<const FQuantizedHeightMapDerivatives, ESPMode::ThreadSafe> SourceQuantizedHeightMapDerivatives;
+	int32 SourceHeightMapSampleSpacing = 0;
+	int32 SourceHeightMapApron = 0;
+	int32 SourceHeightMapStride = 1;
+	int32 SourceHeightMapVersion = INDEX_NONE;
+
+	/* The chunk's job priority when the finished job was handed back. Set on the game thread to sort the finished jobs. @see UTerrainChunk::GetJobPriority */
+	int32 ApplyPriority = 0;
+
+	/* The chunk's job generation when this job was created. INDEX_NONE for jobs that can't be superseded. @see IsSuperseded */
+	int32 Generation = INDEX_NONE;
 
 	/////////////////////////////////////////////////////
 	/* The generated mesh data. */
 	FTerrainMeshData* GeneratedMeshData = nullptr;
 
-	/* The generated height map. */
-	FArray2D* GeneratedHeightMap = nullptr;
+	/* The height-only updates of an update job, one per UpdatedLODs entry. The chunk's meshes take them over on the game thread. */
+	TArray<FTerrainMeshData*> UpdatedMeshData;
+
+	/* The newly generated height map, if the job generated one. Owned by the job until the chunk takes it over on the game thread. */
+	TSharedPtr<const FArray2D, ESPMode::ThreadSafe> GeneratedHeightMap;
+
+	/* The newly generated height map, when the configuration stores them quantized. Set instead of GeneratedHeightMap. */
+	TSharedPtr<const FQuantizedHeightMap, ESPMode::ThreadSafe> GeneratedQuantizedHeightMap;
+
+	/* The slopes of the newly generated height map, if the noise generator could calculate them. Stored like the height map. */
+	TSharedPtr<const FHeightMapDerivatives, ESPMode::ThreadSafe> GeneratedHeightMapDerivatives;
+	TSharedPtr<const FQuantizedHeightMapDerivatives, ESPMode::ThreadSafe> GeneratedQuantizedHeightMapDerivatives;
+
+	/* The sample spacing the octaves of the generated height map were culled for. @see UTerrainChunk::HeightMapSampleSpacing */
+	int32 HeightMapSampleSpacing = 0;
+
+	/* The apron of the generated height map. @see UTerrainChunk::HeightMapApron */
+	int32 HeightMapApron = 0;
+
+	/* The stride of the generated height map. @see UTerrainChunk::HeightMapStride */
+	int32 HeightMapStride = 1;
+
+	/* The version of the height map the mesh data was built from, whether it was generated or cached. @see UTerrainChunk::HeightMapVersion */
+	int32 HeightMapVersion = INDEX_NONE;
 
 	/////////////////////////////////////////////////////
 	FMeshDataJob() {}
 
+	/* Deletes the mesh data this job created, once the chunk took over what it wants from it or the results are thrown away. */
+	void DeleteGeneratedMeshData()
+	{
+		delete GeneratedMeshData;
+		GeneratedMeshData = nullptr;
+		for (FTerrainMeshData* meshData : UpdatedMeshData)
+		{
+			delete meshData;
+		}
+		UpdatedMeshData.Empty();
+	}
+
+	/* Returns true if the chunk doesn't want this job's mesh data anymore, because it requested another LOD since. @see UTerrainChunk::UpdateChunk */
+	FORCEINLINE bool IsSuperseded() const
+	{
+		return Generation != INDEX_NONE && Chunk && Chunk->GetJobGeneration() != Generation;
+	}
+
 	/**
 	 * @param noiseGenerator Noise generator to be used for generating the height map
 	 * @param chunk The chunk that we are creating the mesh data for.
 	 * @param dropOffQueue When we are done, the finished job will be enqueued here.
 	 * @param levelOfDetail The LOD for this mesh data.
-	 * @param offset Add this offset to the noise generator input. This will shift the noise map by this value.
+	 * @param noiseOrigin The chunk's position in noise space. @see FNoiseOrigin
 	 * @param heightCurve (Optional) Height curve to multiply the vertex height with. The X-axis represents the noise generator output (0..1) and the Y axis the modifier.
 	 */
 	FMeshDataJob(UTerrainChunk* chunk, TQueue<FMeshDataJob, EQueueMode::Mpsc>* dropOffQueue, 
-		int32 levelOfDetail, bool bUpdateMeshSection = false, FVector2D offset = FVector2D::ZeroVector):
+		int32 levelOfDetail, bool bUpdateMeshSection = false, const FNoiseOrigin& noiseOrigin = FNoiseOrigin()):
 		Chunk(chunk), 
 		DropOffQueue(dropOffQueue),
 		LevelOfDetail(levelOfDetail),
 		bUpdateMeshSection(bUpdateMeshSection), 
-		Offset(offset)
+		NoiseOrigin(noiseOrigin)
 	{}
 };
\ No newline at end of file
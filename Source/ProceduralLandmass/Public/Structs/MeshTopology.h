@@ -0,0 +1,27 @@
+#pragma once
+#include "CoreMinimal.h"
+
+
+/**
+ * The triangles of a terrain mesh. They only depend on the number of vertices per line, which is the same for every chunk
+ * at a LOD, so the topology is shared (immutable) by all mesh data through @see Get.
+ */
+struct PROCEDURALLANDMASS_API FTerrainMeshTopology
+{
+public:
+	/* The vertex indices of the triangles, 3 per triangle. The vertices are laid out row by row. */
+	TArray<int32> Triangles;
+
+	/* The number of vertices per line of the mesh. */
+	int32 VerticesPerLine = 0;
+
+	/////////////////////////////////////////////////////
+	/**
+	 * Returns the topology for a mesh with the given number of vertices per line. Creates it if no one references it yet.
+	 * Thread-safe.
+	 */
+	static TSharedRef<const FTerrainMeshTopology, ESPMode::ThreadSafe> Get(int32 verticesPerLine);
+
+	/* Builds the topology. Use @see Get instead. */
+	explicit FTerrainMeshTopology(int32 verticesPerLine);
+};
@@ -0,0 +1,127 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "NoiseGraphNode.generated.h"
+
+
+class UCurveFloat;
+
+
+UENUM(BlueprintType)
+enum class ENoiseGraphNodeType : uint8
+{
+	/* Outputs Value. */
+	Constant,
+	/* Single octave noise from Source in -1..1. */
+	Noise,
+	/* Fractal brownian motion of Source in -1..1. */
+	Fbm,
+	/* Ridged multi-fractal of Source in -1..1. Sharp ridges where the noise crosses 0. */
+	Ridged,
+	/* Billow noise of Source in -1..1. Rounded hills, sharp valleys. */
+	Billow,
+	/* Offsets the sample position by Strength * (InputA, InputB). Noise nodes use it through their Coordinates. */
+	DomainWarp,
+	/* Curve(InputA) */
+	Curve,
+	/* InputA + InputB */
+	Add,
+	/* InputA - InputB */
+	Subtract,
+	/* InputA * InputB */
+	Multiply,
+	/* Min(InputA, InputB) */
+	Min,
+	/* Max(InputA, InputB) */
+	Max,
+	/* Lerp(InputA, InputB, InputC) */
+	Lerp,
+	/* InputA * Scale + Bias */
+	ScaleBias,
+	/* Abs(InputA) */
+	Abs,
+	/* Clamp(InputA, ClampMin, ClampMax) */
+	Clamp,
+	/* Falloff around the world origin (@see UUnityLibrary::GetFalloffValue). 0 in the center, 1 at FalloffSize / 2 and beyond. */
+	Falloff
+};
+
+UENUM(BlueprintType)
+enum class ENoiseGraphSource : uint8
+{
+	Perlin,
+	Simplex
+};
+
+
+/**
+ * A single node of a noise graph (@see UNoiseGraphGenerator).
+ * Inputs reference other nodes by their index in the graph and must point to an earlier node.
+ * Unused parameters are ignored.
+ */
+USTRUCT(BlueprintType)
+struct FNoiseGraphNode
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	ENoiseGraphNodeType Type = ENoiseGraphNodeType::Fbm;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = -1))
+	int32 InputA = INDEX_NONE;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = -1))
+	int32 InputB = INDEX_NONE;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = -1))
+	int32 InputC = INDEX_NONE;
+
+	/* Index of a domain warp node whose warped position noise nodes sample at. -1 samples at the unwarped position. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = -1))
+	int32 Coordinates = INDEX_NONE;
+
+	/////////////////////////////////////////////////////
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Noise")
+	ENoiseGraphSource Source = ENoiseGraphSource::Perlin;
+
+	/* Multiplier for the generator's base frequency (1 / NoiseScale). */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Noise", meta = (ClampMin = 0.0f))
+	float Frequency = 1.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Noise", meta = (ClampMin = 1, ClampMax = 16))
+	int32 Octaves = 4;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Noise")
+	float Persistence = 0.5f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Noise")
+	float Lacunarity = 2.0f;
+
+	/////////////////////////////////////////////////////
+	/* Output of constant nodes. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parameters")
+	float Value = 0.0f;
+
+	/* Domain warp distance in world units (the same units as the noise generator input). */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parameters")
+	float Strength = 10.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parameters")
+	float Scale = 1.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parameters")
+	float Bias = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parameters")
+	float ClampMin = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parameters")
+	float ClampMax = 1.0f;
+
+	/* Edge length of the falloff square in world units. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parameters", meta = (ClampMin = 1.0f))
+	float FalloffSize = 4800.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parameters")
+	UCurveFloat* Curve = nullptr;
+};
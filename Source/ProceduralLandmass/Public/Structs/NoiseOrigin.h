@@ -0,0 +1,18 @@
+#pragma once
+#include "CoreMinimal.h"
+
+
+/**
+ * A position in noise space (world units, before the noise scale) in double precision.
+ * Chunks sample the noise relative to their origin with small float offsets. The native generators move the origin
+ * into the period of the noise lattice per octave, so that the precision of the noise doesn't depend on how far away
+ * from the world origin a chunk is.
+ */
+struct FNoiseOrigin
+{
+	double X = 0.0;
+	double Y = 0.0;
+
+	FNoiseOrigin() {}
+	FNoiseOrigin(double x, double y) : X(x), Y(y) {}
+};
@@ -0,0 +1,39 @@
+#pragma once
+#include "CoreMinimal.h"
+
+
+/**
+ * Immutable permutation and gradient tables for the lattice noise generators.
+ * The whole block is about 5.5 KB and cache line aligned, so it stays in L1 while sampling.
+ * Tables are shared: every generator (and every copy of it on the worker threads) that uses the same seed
+ * references the same block through @see Get, instead of owning its own copy.
+ */
+MS_ALIGN(PLATFORM_CACHE_LINE_SIZE) struct PROCEDURALLANDMASS_API FPerlinNoiseTables
+{
+public:
+	static const int32 B = 256;
+	static const int32 BM = 255;
+
+	/* The permutation, stored twice so that Permutation[Permutation[x] + y] never has to wrap. */
+	uint8 Permutation[B + B];
+
+	/* Normalized 2D gradients. Indexed with a permutation value. */
+	FVector2D Gradients2D[B];
+
+	/* Normalized 3D gradients. Indexed with a permutation value. */
+	FVector Gradients3D[B];
+
+	/////////////////////////////////////////////////////
+	/**
+	 * Returns the tables for the given seed. Creates them if no one references them yet.
+	 * Thread-safe.
+	 * @param seed The (current) seed of the random stream the tables are generated from.
+	 */
+	static TSharedRef<const FPerlinNoiseTables, ESPMode::ThreadSafe> Get(int32 seed);
+
+	/**
+	 * Generates the tables. Use @see Get instead, unless the tables have to live in static storage
+	 * (e.g. for a fixed seed that is needed for the entire lifetime of the module).
+	 */
+	explicit FPerlinNoiseTables(int32 seed);
+} GCC_ALIGN(PLATFORM_CACHE_LINE_SIZE);
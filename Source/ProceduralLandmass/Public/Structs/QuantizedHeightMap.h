@@ -0,0 +1,101 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "Array2D.h"
+
+
+/**
+ * A height map stored as 16 bit integers with a scale and bias, half the size of an @see FArray2D.
+ * The scale and bias are per height map, so the full 16 bits cover the range of values that are actually in it.
+ * A value is decoded as Bias + quantized * Scale, the error is at most Scale / 2.
+ */
+struct FQuantizedHeightMap
+{
+protected:
+	TArray<uint16> Values;
+
+	int32 NumRows = 0;
+	int32 NumColumns = 0;
+
+	float Scale = 0.0f;
+	float Bias = 0.0f;
+
+public:
+	FQuantizedHeightMap() {}
+
+	explicit FQuantizedHeightMap(const FArray2D& heightMap)
+	{
+		Encode(heightMap);
+	}
+
+	/* Quantizes the given height map. */
+	void Encode(const FArray2D& heightMap)
+	{
+		NumRows = heightMap.GetHeight();
+		NumColumns = heightMap.GetWidth();
+
+		const int32 num = heightMap.Num();
+		const float* RESTRICT source = heightMap.GetData();
+		float minValue = num > 0 ? source[0] : 0.0f;
+		float maxValue = minValue;
+		for (int32 i = 1; i < num; i++)
+		{
+			minValue = FMath::Min(minValue, source[i]);
+			maxValue = FMath::Max(maxValue, source[i]);
+		}
+
+		Bias = minValue;
+		Scale = (maxValue - minValue) / (float)MAX_uint16;
+		const float inverseScale = Scale > 0.0f ? 1.0f / Scale : 0.0f;
+
+		Values.SetNumUninitialized(num);
+		uint16* RESTRICT destination = Values.GetData();
+		for (int32 i = 0; i < num; i++)
+		{
+			destination[i] = (uint16)FMath::Clamp(FMath::RoundToInt((source[i] - Bias) * inverseScale), 0, (int32)MAX_uint16);
+		}
+	}
+
+	/* Decodes the entire height map into outHeightMap, resizing it if necessary. */
+	void Decode(FArray2D& outHeightMap) const
+	{
+		if (outHeightMap.GetWidth() != NumColumns || outHeightMap.GetHeight() != NumRows)
+		{
+			outHeightMap = FArray2D(NumColumns, NumRows);
+		}
+
+		for (int32 y = 0; y < NumRows; y++)
+		{
+			DecodeRow(y, outHeightMap.GetRow(y));
+		}
+	}
+
+	/* Decodes row y into outValues, which must have room for GetWidth() floats. */
+	FORCEINLINE void DecodeRow(int32 y, float* RESTRICT outValues) const
+	{
+		const uint16* RESTRICT row = Values.GetData() + y * NumColumns;
+		for (int32 x = 0; x < NumColumns; x++)
+		{
+			outValues[x] = Bias + row[x] * Scale;
+		}
+	}
+
+	/* Returns the decoded value at column x and row y. */
+	FORCEINLINE float GetValue(int32 x, int32 y) const
+	{
+		return Bias + Values[y * NumColumns + x] * Scale;
+	}
+
+	FORCEINLINE int32 GetHeight() const { return NumRows; };
+	FORCEINLINE int32 GetWidth() const { return NumColumns; };
+
+	/* The allocated size in bytes. */
+	FORCEINLINE SIZE_T GetAllocatedSize() const { return Values.GetAllocatedSize(); };
+
+	/* Serializes the quantized values as they are, which makes for a compact on-disk format. */
+	friend FArchive& operator<<(FArchive& archive, FQuantizedHeightMap& heightMap)
+	{
+		archive << heightMap.NumRows << heightMap.NumColumns << heightMap.Scale << heightMap.Bias;
+		heightMap.Values.BulkSerialize(archive);
+		return archive;
+	}
+};
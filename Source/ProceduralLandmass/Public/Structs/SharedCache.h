@@ -0,0 +1,44 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "Misc/ScopeLock.h"
+
+
+/**
+ * Shares immutable values that are expensive to build between everyone who asks for the same key.
+ * The cache only holds weak references, a value is freed once the last one using it lets go of it. Thread-safe.
+ */
+template<typename KeyType, typename ValueType>
+class TSharedCache
+{
+public:
+	using FValuePtr = TSharedPtr<const ValueType, ESPMode::ThreadSafe>;
+	using FValueRef = TSharedRef<const ValueType, ESPMode::ThreadSafe>;
+
+	/* Returns the value for the key. If no one references it yet, it is created with the given function and the entries of values that
+	 * were freed since are removed, so keys that aren't used anymore don't pile up. */
+	FValueRef FindOrAdd(const KeyType& key, TFunctionRef<FValueRef()> createValue)
+	{
+		FScopeLock lock(&Mutex);
+
+		FValuePtr value = Values.FindRef(key).Pin();
+		if (!value.IsValid())
+		{
+			for (auto it = Values.CreateIterator(); it; ++it)
+			{
+				if (!it.Value().IsValid())
+				{
+					it.RemoveCurrent();
+				}
+			}
+
+			value = createValue();
+			Values.Add(key, value);
+		}
+
+		return value.ToSharedRef();
+	}
+
+private:
+	FCriticalSection Mutex;
+	TMap<KeyType, TWeakPtr<const ValueType, ESPMode::ThreadSafe>> Values;
+};
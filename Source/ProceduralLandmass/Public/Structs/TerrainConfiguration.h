@@ -1,6 +1,8 @@
 #pragma once
 #include "Structs/LODInfo.h"
 #include "Public/NoiseGeneratorInterface.h"
+#include "HeightCurveTable.h"
+#include "MeshAttributes.h"
 #include "TerrainConfiguration.generated.h"
 
 
@@ -16,6 +18,16 @@ enum class ENumVertices : uint8
 	x241 = 241
 };
 
+/* How chunks keep their height map after the mesh data was generated. */
+UENUM(BlueprintType)
+enum class EHeightMapStorage : uint8
+{
+	/* 32 bit floats. */
+	Float,
+	/* 16 bit integers with a per chunk scale and bias. Half the memory, the height is off by at most 1/131070 of the chunk's height range. */
+	Quantized16
+};
+
 UENUM(BlueprintType)
 enum class ECollisonMode : uint8
 {
@@ -42,7 +54,10 @@ public:
 
 	/* The noise generator object. */
 	UPROPERTY(BlueprintReadOnly)
-	UNoiseGenerator* NoiseGenerator;
+	UNoiseGenerator* NoiseGenerator = nullptr;
+
+	/* The hash of the noise generator class' default parameters, which the noise generator is created with. @see HashNoiseParameters */
+	uint32 NoiseParametersHash = 0;
 
 	/* Number of vertices per direction per chunk. */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
@@ -60,12 +75,47 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 1.0f))
 	float Amplitude = 17.5;
 
+	/** Skip noise octaves that are too fine for the spacing of a chunk's height map samples. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bCullOctavesForLOD = true;
+
+	/** Number of extra height map samples generated around each chunk. Meshes that accumulate face normals need at least their
+	 * mesh simplification increment, so the height maps get an apron as wide as the coarsest LOD's increment if this is smaller. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = 0))
+	int32 HeightMapApron = 1;
+
+	/** Chunks that start out with a coarse LOD only generate the height map samples that LOD uses. The full resolution height map
+	 * is generated when a finer LOD is needed. Makes the initial generation of far away chunks a lot cheaper. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bSparseHeightMapsForFarLODs = true;
+
+	/** The vertex attributes the meshes are generated with. Leave out what the terrain material doesn't read, that saves memory,
+	 * build time and upload bandwidth. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (Bitmask, BitmaskEnum = "EMeshAttribute"))
+	int32 MeshAttributes = FMeshAttributes::All;
+
+	/** How the normals are calculated when the noise generator can't give us its derivatives. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	ENormalQuality NormalQuality = ENormalQuality::FaceNormals;
+
+	/** Keep the normals of the cached meshes octahedron encoded in 32 bits instead of 96. They are decoded when a mesh section is created. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bPackNormals = false;
+
+	/** How chunks store their height maps. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	EHeightMapStorage HeightMapStorage = EHeightMapStorage::Float;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	ECollisonMode Collision = ECollisonMode::NoCollision;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	UCurveFloat* HeightCurve = nullptr;
 
+	/* The height curve baked into a lookup table. This is what the worker threads use, they never touch the curve itself.
+	 * Shared by all copies of the configuration. @see BakeHeightCurve */
+	TSharedPtr<const FHeightCurveTable, ESPMode::ThreadSafe> HeightCurveTable;
+
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	TArray<FLODInfo> LODs = TArray<FLODInfo>();
 
@@ -90,14 +140,64 @@ public:
 		(
 			NumberOfThreads == other.NumberOfThreads &&
 			NoiseGeneratorClass == other.NoiseGeneratorClass &&
+			NoiseParametersHash == other.NoiseParametersHash &&
 			NumVertices == other.NumVertices &&
 			MapScale == other.MapScale &&
 			NumChunks == other.NumChunks &&
 			Amplitude == other.Amplitude &&
-			HeightCurve == other.HeightCurve
+			bCullOctavesForLOD == other.bCullOctavesForLOD &&
+			HeightMapApron == other.HeightMapApron &&
+			bSparseHeightMapsForFarLODs == other.bSparseHeightMapsForFarLODs &&
+			MeshAttributes == other.MeshAttributes &&
+			bPackNormals == other.bPackNormals &&
+			NormalQuality == other.NormalQuality &&
+			HeightMapStorage == other.HeightMapStorage &&
+			HeightCurve == other.HeightCurve &&
+			FHeightCurveTable::AreEqual(HeightCurveTable.Get(), other.HeightCurveTable.Get())
+		);
+	}
+
+	/* Returns true if the chunks and meshes of the other configuration can be kept for this one, so that only their heights have to be updated. */
+	bool HasSameMeshLayout(const FTerrainConfiguration& other) const
+	{
+		return
+		(
+			NumVertices == other.NumVertices &&
+			MapScale == other.MapScale &&
+			NumChunks == other.NumChunks &&
+			HeightMapApron == other.HeightMapApron &&
+			bSparseHeightMapsForFarLODs == other.bSparseHeightMapsForFarLODs &&
+			MeshAttributes == other.MeshAttributes &&
+			bPackNormals == other.bPackNormals &&
+			NormalQuality == other.NormalQuality &&
+			HeightMapStorage == other.HeightMapStorage
 		);
 	}
 
+	/* Returns true if the other configuration generates the same height maps. Amplitude and height curve are applied on top of them. */
+	bool GeneratesSameHeightMaps(const FTerrainConfiguration& other) const
+	{
+		return NoiseGeneratorClass == other.NoiseGeneratorClass && NoiseParametersHash == other.NoiseParametersHash && NumVertices == other.NumVertices 
+			&& bCullOctavesForLOD == other.bCullOctavesForLOD;
+	}
+
+	/* Hashes the noise generator class' parameters (@see UNoiseGenerator::GetParametersHash). Has to be called whenever they may have
+	 * changed, before the configuration is compared. */
+	void HashNoiseParameters()
+	{
+		NoiseParametersHash = NoiseGeneratorClass ? NoiseGeneratorClass.GetDefaultObject()->GetParametersHash() : 0;
+	}
+
+	/* Bakes the height curve into the lookup table. Has to be called whenever the curve changed, before the configuration is handed to the workers. */
+	void BakeHeightCurve()
+	{
+		HeightCurveTable.Reset();
+		if (HeightCurve)
+		{
+			HeightCurveTable = MakeShared<const FHeightCurveTable, ESPMode::ThreadSafe>(*HeightCurve);
+		}
+	}
+
 	///////////////////////////////////////////////////////
 	void CopyConfiguration(const FTerrainConfiguration& reference)
 	{
@@ -106,14 +206,20 @@ public:
 		MapScale = reference.MapScale;
 		NumChunks = reference.NumChunks;
 		Amplitude = reference.Amplitude;
+		bCullOctavesForLOD = reference.bCullOctavesForLOD;
+		HeightMapApron = reference.HeightMapApron;
+		bSparseHeightMapsForFarLODs = reference.bSparseHeightMapsForFarLODs;
+		MeshAttributes = reference.MeshAttributes;
+		bPackNormals = reference.bPackNormals;
+		NormalQuality = reference.NormalQuality;
+		HeightMapStorage = reference.HeightMapStorage;
 		Collision = reference.Collision;
 		LODs = reference.LODs;
 		NoiseGeneratorClass = reference.NoiseGeneratorClass;
+		NoiseParametersHash = reference.NoiseParametersHash;
 
-		if (reference.HeightCurve)
-		{
-			HeightCurve = DuplicateObject<UCurveFloat>(reference.HeightCurve, nullptr);
-		}
+		HeightCurve = reference.HeightCurve;
+		HeightCurveTable = reference.HeightCurveTable;
 
 		UNoiseGenerator* otherNoiseGenerator = reference.NoiseGenerator;
 		if (otherNoiseGenerator)
@@ -170,4 +276,34 @@ public:
 	{
 		return GetNumVertices() - 1;
 	}
+
+	/* Returns the mesh simplification increment of the coarsest LOD. */
+	int32 GetMaxMeshSimplificationIncrement() const
+	{
+		int32 maxIncrement = 1;
+		for (const FLODInfo& lodInfo : LODs)
+		{
+			maxIncrement = FMath::Max(maxIncrement, lodInfo.LOD == 0 ? 1 : lodInfo.LOD * 2);
+		}
+		return maxIncrement;
+	}
+};
+
+
+/**
+ * An immutable copy of the configuration with a version number. The terrain generator publishes a new one whenever the configuration changes
+ * (@see ATerrainGenerator::PublishConfiguration), every job keeps the one it was created with. So a worker thread never sees the configuration
+ * change while it works, and results of an older configuration are told apart by their version.
+ */
+struct FTerrainConfigurationSnapshot
+{
+	const FTerrainConfiguration Configuration;
+	const int32 Version;
+
+	/* The version of the oldest configuration since that generates the same height maps as this one (@see FTerrainConfiguration::GeneratesSameHeightMaps).
+	 * Height maps are stamped with it, a height map with another one was generated from different noise. */
+	const int32 HeightMapVersion;
+
+	FTerrainConfigurationSnapshot(const FTerrainConfiguration& configuration, int32 version, int32 heightMapVersion) : 
+		Configuration(configuration), Version(version), HeightMapVersion(heightMapVersion) {}
 };
@@ -3,6 +3,10 @@
 #include "Structs/LODInfo.h"
 #include "ProceduralMeshComponent.h"
 #include "MeshData.h"
+#include "NoiseOrigin.h"
+#include "QuantizedHeightMap.h"
+#include "HeightMapDerivatives.h"
+#include "HAL/ThreadSafeCounter.h"
 #include "TerrainChunk.generated.h"
 
 
@@ -40,7 +44,34 @@ public:
 	EChunkStatus Status = EChunkStatus::SPAWNED;
 
 	TArray<FTerrainMeshData*> LODMeshes;
-	FArray2D* HeightMap;
+
+	/* Our height map. Never written to once generated, a new one replaces it on the game thread. Shared with the jobs that read it,
+	 * whoever lets go of it last frees it. */
+	TSharedPtr<const FArray2D, ESPMode::ThreadSafe> HeightMap;
+
+	/* Our height map when the configuration stores them quantized (@see EHeightMapStorage). Only one of HeightMap and this is set.
+	 * Shared with the jobs that decode it, so that replacing it doesn't pull it away from under them. */
+	TSharedPtr<const FQuantizedHeightMap, ESPMode::ThreadSafe> QuantizedHeightMap;
+
+	/* The slopes of our height map, if the noise generator could calculate them. Stored and shared like the height map they belong to,
+	 * so every LOD gets its normals the same way. */
+	TSharedPtr<const FHeightMapDerivatives, ESPMode::ThreadSafe> HeightMapDerivatives;
+	TSharedPtr<const FQuantizedHeightMapDerivatives, ESPMode::ThreadSafe> QuantizedHeightMapDerivatives;
+
+	/* The sample spacing the octaves of our height map were culled for (@see UNoiseGenerator::GetNoise2DLine). 0 means all octaves. */
+	int32 HeightMapSampleSpacing = 0;
+
+	/* The number of samples our height map has around our mesh on every side. @see FTerrainConfiguration::HeightMapApron */
+	int32 HeightMapApron = 0;
+
+	/* The distance between two of our height map samples in mesh units. Greater than 1 when only the samples of coarse LODs were generated. */
+	int32 HeightMapStride = 1;
+
+	/* The height map version of the configuration our height map was generated with. @see FTerrainConfigurationSnapshot::HeightMapVersion */
+	int32 HeightMapVersion = INDEX_NONE;
+
+	/* Our center in noise space, in double precision. Our height map is sampled relative to it, so that far away chunks keep their precision. */
+	FNoiseOrigin NoiseOrigin;
 
 	/* The player's camera location. Used for level of detail.
 	 * This location is updated in the Terrain generator's tick functions. */
@@ -49,10 +80,18 @@ public:
 	/* The player's camera location in the last frame. */
 	static FVector LastCameraLocation;
 
+	/* The direction the player's camera looks at. Zero if unknown. Updated with @see CameraLocation. */
+	static FVector CameraDirection;
+
 private:
 	int32 CurrentLOD = 0;
 
-	TArray<bool> RequestedMeshData;
+	/* The LOD we requested mesh data for and are waiting for. INDEX_NONE if none. */
+	int32 PendingLOD = INDEX_NONE;
+
+	/* Incremented whenever we don't want the mesh data we requested anymore. Our LOD jobs are stamped with it, a job with an older
+	 * generation is superseded. Read by the worker threads. */
+	FThreadSafeCounter JobGeneration;
 
 	TArray<FLODInfo>* DetailLevels;
 
@@ -74,4 +113,18 @@ public:
 	void UpdateChunk();
 
 	int32 GetOptimalLOD(FVector cameraLocation);
+
+	FORCEINLINE int32 GetJobGeneration() const { return JobGeneration.GetValue(); };
+
+	/**
+	 * Returns the priority bucket for our mesh data jobs (@see FTerrainJobScheduler), from the current camera location and direction.
+	 * One bucket per ring of chunks around the camera, chunks behind the camera count up to twice as far away.
+	 */
+	int32 GetJobPriority() const;
+
+	FORCEINLINE bool HasHeightMap() const { return HeightMap.IsValid() || QuantizedHeightMap.IsValid(); };
+
+	/* Returns our height map's value at column x and row y of our mesh, whichever way it is stored. x and y must be multiples of
+	 * HeightMapStride. 0 if we don't have a height map yet. */
+	float GetHeightMapValue(int32 x, int32 y) const;
 };
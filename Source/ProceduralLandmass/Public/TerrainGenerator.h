@@ -20,6 +20,7 @@ class AStaticMeshActor;
 struct FTerrainMeshData;
 struct FLinearColor;
 class FTerrainGeneratorWorker;
+class FTerrainJobScheduler;
 
 
 UENUM(BlueprintType)
@@ -51,9 +52,25 @@ protected:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Map Generator|General")
 	EDrawMode DrawMode = EDrawMode::Mesh;
 
+	/* Time in milliseconds per frame for uploading finished meshes. What doesn't fit is uploaded in the next frames, closest chunks first.
+	 * At least one mesh is uploaded per frame. 0 means no limit. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Map Generator|General", meta = (ClampMin = 0.0f))
+	float MeshApplyTimeBudget = 4.0f;
+
+	/* Number of vertices per frame for uploading finished meshes. @see MeshApplyTimeBudget. 0 means no limit. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Map Generator|General", meta = (ClampMin = 0))
+	int32 MeshApplyVertexBudget = 0;
+
+	/* Print the number of remaining mesh data jobs every frame. */
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Map Generator|Debug")
+	bool bShowJobsRemaining = false;
+
 	/* Array of all worker threads. Pointers can be null. */
 	TArray<FTerrainGeneratorWorker*> WorkerThreads;
 
+	/* Hands the mesh data jobs out to the worker threads. */
+	TSharedPtr<FTerrainJobScheduler, ESPMode::ThreadSafe> JobScheduler;
+
 	/* All chunks that belong to this terrain. */
 	TMap<FVector2D, UTerrainChunk*> Chunks;
 
@@ -63,8 +80,24 @@ protected:
 	/* Timer handle for @see EditorTick() */
 	FTimerHandle THEditorTick;
 
+	/* The camera location and direction the pending jobs were last prioritized for. @see UpdateJobPriorities */
+	FVector PrioritizedCameraLocation = FVector::ZeroVector;
+	FVector PrioritizedCameraDirection = FVector::ZeroVector;
+
 	/* The configuration before it changed. Used to determent which values did change. */
 	FTerrainConfiguration OldConfiguration;
+
+	/* The latest published configuration. New jobs are created with it. @see PublishConfiguration */
+	TSharedPtr<const FTerrainConfigurationSnapshot, ESPMode::ThreadSafe> ConfigurationSnapshot;
+
+	/* All published configurations that jobs may still use. Keeps their noise generators from being garbage collected. */
+	TArray<TSharedPtr<const FTerrainConfigurationSnapshot, ESPMode::ThreadSafe>> PublishedSnapshots;
+
+	/* The version of the latest published configuration. */
+	int32 ConfigurationVersion = 0;
+
+	/* The configuration version the current chunks were created with. Results of older versions are for chunks that were cleared since. */
+	int32 TerrainVersion = 0;
 	
 public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Map Generator")
@@ -75,6 +108,9 @@ public:
 	
 	/* Queue for finished jobs */
 	TQueue<FMeshDataJob, EQueueMode::Mpsc> FinishedMeshDataJobs;
+
+	/* Finished jobs that didn't fit into the budget of the frames so far. @see MeshApplyTimeBudget */
+	TArray<FMeshDataJob> FinishedJobsToApply;
 	
 private:
 	/* Number of mesh data jobs remaining */
@@ -91,7 +127,7 @@ private:
 	/////////////////////////////////////////////////////
 public:
 	UFUNCTION(BlueprintCallable, Category = "Map Generator")
-	void CreateAndEnqueueMeshDataJob(UTerrainChunk* chunk, int32 levelOfDetail, bool bUpdateMeshSection = false, const FVector2D& offset = FVector2D::ZeroVector);
+	void CreateAndEnqueueMeshDataJob(UTerrainChunk* chunk, int32 levelOfDetail, bool bUpdateMeshSection = false, bool bRegenerateHeightMap = true);
 
 	/** Returns the actual terrain size (in cm) along one direction (= edge length).
 	 * Takes the map scale into account! */
@@ -129,6 +165,21 @@ protected:
 
 	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Map Generator|General")
 	bool bClearTerrain = false;
+
+	/** Times the calculation of the mesh normals with every @see ENormalQuality for every chunk size (@see ENumVertices) and prints the results. */
+	UFUNCTION(BlueprintCallable, Category = "Map Generator")
+	void BenchmarkNormals();
+
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Map Generator|General")
+	bool bBenchmarkNormals = false;
+
+	/** Times filling 3D noise bricks of a few sizes with @see UNoiseGenerator::GetNoise3DBrick against one GetNoise3D call per sample,
+	 * with the configured noise generator, and prints the samples per second of both. */
+	UFUNCTION(BlueprintCallable, Category = "Map Generator")
+	void BenchmarkNoise3D();
+
+	UPROPERTY(BlueprintReadOnly, EditAnywhere, Category = "Map Generator|General")
+	bool bBenchmarkNoise3D = false;
 	
 	virtual void BeginPlay() override;
 	virtual void Tick(float DeltaSeconds) override;
@@ -143,9 +194,25 @@ private:
 	void EditorTick();
 
 	void UpdateChunkLOD();
+
+	/* Re-ranks the pending mesh data jobs when the camera moved half a chunk or turned since they were last ranked. */
+	void UpdateJobPriorities();
 	
 	void ClearThreads();
 	void ClearTimers();
 	
+	/* Applies the finished jobs to their chunks, within the budget per frame. @see MeshApplyTimeBudget */
 	void HandleFinishedMeshDataJobs();
+
+	/* Uploads the job's mesh data to its chunk. Returns the number of vertices uploaded. */
+	int32 ApplyFinishedMeshDataJob(FMeshDataJob& job);
+
+	/* Publishes a copy of the current configuration for the jobs created from now on. @see FTerrainConfigurationSnapshot */
+	void PublishConfiguration();
+
+	/* Drops the published configurations that no job uses anymore. */
+	void ReleaseUnusedSnapshots();
+
+public:
+	static void AddReferencedObjects(UObject* inThis, FReferenceCollector& collector);
 };
@@ -3,49 +3,35 @@
 #pragma once
 #include "CoreMinimal.h"
 #include "Runnable.h"
-#include "Queue.h"
 #include "MeshDataJob.h"
 #include "ThreadSafeBool.h"
 
 
 class FRunnableThread;
+class FTerrainJobScheduler;
 
 
 /**
  * Worker thread for generating mesh data.
- * This thread will work through the PendingJobs queue until it's empty.
- * When it's empty, it will destroy itself.
- * Will start in pause mode and must be 'activated' manually with @see UnPause().
+ * This thread takes jobs from the scheduler (@see FTerrainJobScheduler) until there are none left, then waits for new ones.
  */
 class PROCEDURALLANDMASS_API FTerrainGeneratorWorker : public FRunnable
 {	
 public:
 	/**
 	 * Creates a new terrain generator worker thread and starts it.
-	 * @param configuration The terrain configuration to use. We will make a copy of it to be thread-safe.
-	 * @param outer The outer object for the terrain configuration's objects (noise generator and float curve).
+	 * @param scheduler The scheduler to take the jobs from. Shared by all workers.
+	 * @param workerIndex The index of this worker's job deques in the scheduler.
 	 */
-	FTerrainGeneratorWorker(const FTerrainConfiguration& configuration);
+	FTerrainGeneratorWorker(const TSharedRef<FTerrainJobScheduler, ESPMode::ThreadSafe>& scheduler, int32 workerIndex);
 	~FTerrainGeneratorWorker();
 
-	/* Job queue for this worker. */
-	TQueue<FMeshDataJob, EQueueMode::Spsc> PendingJobs;
-
-	/* Priority job queue for this worker. */
-	TQueue<FMeshDataJob, EQueueMode::Spsc> PriorityJobs;
-
 	/* Does the actual work of this thread. This function is static,
 	 * so it can be called manually if we are not using multi-threading. */
 	void DoWork(FMeshDataJob& currentJob);
 
 	FORCEINLINE void Pause() { bPause = true; }
-	FORCEINLINE void UnPause()
-	{
-		bPause = false;
-		Semaphore->Trigger();
-	}
-
-	void UpdateConfiguration(const FTerrainConfiguration& newConfig);
+	void UnPause();
 
 private:
 	FThreadSafeBool bPause = false;
@@ -53,22 +39,26 @@ private:
 	/* Should this thread be killed? */
 	FThreadSafeBool bWorkFinished = false;
 
-	/* This will be used to let this thread wait until it is woken up the main thread. */
-	FEvent* Semaphore;
+	/* Where we get our jobs from. Also wakes us up when there are new ones. */
+	TSharedRef<FTerrainJobScheduler, ESPMode::ThreadSafe> Scheduler;
+
+	int32 WorkerIndex;
 
 	/* The thread we are running on. */
 	FRunnableThread* Thread;
 
-	FTerrainConfiguration Configuration;
+	/* Quantized height maps are decoded into this for building meshes. Reused between jobs. */
+	FArray2D DecodedHeightMap;
+
+	/* The same for the slopes of quantized height maps. */
+	FArray2D DecodedDerivativesX;
+	FArray2D DecodedDerivativesY;
 
 	FString ThreadName;
 
 	static int32 ThreadCounter;
 	static int32 GetNewThreadNumber() { return ThreadCounter++; };
 
-	/* Clears the job queue and deletes the data inside. */
-	void ClearJobQueue();
-
 
 	/////////////////////////////////////////////////////
 				/* Runnable interface */
@@ -0,0 +1,104 @@
+#pragma once
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeBool.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "MeshDataJob.h"
+
+
+/**
+ * Distributes the mesh data jobs over the worker threads.
+ * Every worker has its own job deques, one per priority bucket (@see UTerrainChunk::GetJobPriority). A worker works through its own jobs front to back, highest priority first.
+ * A worker that runs out of jobs steals from the back of the busiest worker's deques, so one expensive job doesn't stall the
+ * jobs queued behind it while other workers are idle.
+ * Jobs are submitted from the game thread, everything else is thread-safe.
+ */
+class PROCEDURALLANDMASS_API FTerrainJobScheduler
+{
+public:
+	/* The number of priority buckets. Lower priorities are done first. */
+	static const int32 NumPriorities = 16;
+
+	/**
+	 * @param numWorkers The number of worker threads that will take jobs from this scheduler. Each one gets its own deques.
+	 */
+	explicit FTerrainJobScheduler(int32 numWorkers);
+	~FTerrainJobScheduler();
+
+	/* Adds the job to the deque of an idle worker, or the one with the fewest jobs, and wakes it up. */
+	void Submit(const FMeshDataJob& job, int32 priority);
+
+	/**
+	 * Takes the next job for the given worker. If it has none left, it steals one from another worker.
+	 * @return False if there are no jobs at all.
+	 */
+	bool GetNextJob(int32 workerIndex, FMeshDataJob& outJob);
+
+	/**
+	 * Blocks the worker until a job was submitted for it or @see WakeUp was called.
+	 * @param bReturnIfJobsQueued Don't block if there are jobs the worker could take. A paused worker waits regardless.
+	 */
+	void WaitForJob(int32 workerIndex, bool bReturnIfJobsQueued = true);
+
+	/* Wakes the worker up, whether there is a job for it or not. */
+	void WakeUp(int32 workerIndex);
+
+	/**
+	 * Moves all jobs that haven't been started yet into the bucket the function returns for them.
+	 * Jobs in the same bucket keep their order. Call this when the priorities changed, e.g. because the camera moved.
+	 */
+	void Reprioritize(TFunctionRef<int32(const FMeshDataJob&)> getPriority);
+
+	/* Removes all jobs that haven't been started yet. */
+	void ClearJobs();
+
+	FORCEINLINE int32 GetNumWorkers() const { return WorkerQueues.Num(); }
+
+	/* The number of jobs that were done by another worker than the one they were submitted to. */
+	FORCEINLINE int32 GetNumStolenJobs() const { return NumStolenJobs.GetValue(); }
+
+private:
+	/* A double ended queue in a ring buffer. Not thread-safe. */
+	struct FJobDeque
+	{
+		TArray<FMeshDataJob> Jobs;
+		int32 Head = 0;
+		int32 Num = 0;
+
+		void PushBack(const FMeshDataJob& job);
+		FMeshDataJob PopFront();
+		FMeshDataJob PopBack();
+		void Empty();
+	};
+
+	/* The jobs of one worker. */
+	struct FWorkerQueue
+	{
+		FCriticalSection Mutex;
+		FJobDeque Deques[NumPriorities];
+
+		/* The number of jobs in all deques. Read without the lock to pick workers. */
+		FThreadSafeCounter NumJobs;
+
+		/* Is the worker waiting for a job? Set under the lock before the worker looks for jobs a last time, so a job submitted meanwhile
+		 * is either found by the worker or its submitter sees the worker idle and wakes it up. */
+		FThreadSafeBool bIdle = false;
+
+		FEvent* WakeUpEvent = nullptr;
+	};
+
+	TArray<TUniquePtr<FWorkerQueue>> WorkerQueues;
+
+	/* The worker the search for an idle worker starts at, so jobs are spread evenly. Only used on the game thread. */
+	int32 NextWorker = 0;
+
+	FThreadSafeCounter NumStolenJobs;
+
+	/* Pops the front of the highest priority non-empty deque of the queue. */
+	static bool PopOwnJob(FWorkerQueue& queue, FMeshDataJob& outJob);
+
+	/* Pops the back of the highest priority non-empty deque of the worker with the most jobs. */
+	bool StealJob(int32 thiefIndex, FMeshDataJob& outJob);
+
+	/* Returns true if any worker has jobs left. */
+	bool HasJobs() const;
+};
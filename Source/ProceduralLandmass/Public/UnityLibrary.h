@@ -24,6 +24,7 @@ public:
 	/////////////////////////////////////////////////////
 	/** Implementation of 2D Perlin noise based on Ken Perlin's original version (http://mrl.nyu.edu/~perlin/doc/oscar.html)
 	 * (See Random1.tps for additional third party software info.)
+	 * Thread-safe. The tables are created when the module is loaded, so this can be called from any number of threads at once.
 	 * @return A value between -1 and 1. 
 	 */
 	static float PerlinNoise(float x, float y);
@@ -31,6 +32,20 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Unity Library|Noise")
 	static float PerlinNoise(const FVector2D& vec);
 
+	/**
+	 * Samples the Perlin noise along a line, four samples at a time, so that
+	 * outValues[i] = PerlinNoise(startX + i * stepX, startY + i * stepY).
+	 * Thread-safe, like PerlinNoise.
+	 * @param outValues Must have room for at least numValues floats.
+	 */
+	static void PerlinNoiseLine(float* outValues, int32 numValues, float startX, float startY, float stepX, float stepY);
+
+	/**
+	 * Fills the entire array with Perlin noise. The rows are sampled in parallel.
+	 * The value at column x and row y will be the noise at origin + (x, y) * step.
+	 */
+	static void PerlinNoiseGrid(FArray2D& outValues, const FVector2D& origin, float step = 1.0f);
+
 
 	/////////////////////////////////////////////////////
 					/* Falloff Generator */
@@ -40,6 +55,12 @@ public:
 	 */
 	static FArray2D* GenerateFalloffMap(int32 size);
 
+	/**
+	 * The falloff curve. Maps the distance from the center (0 = center, 1 = edge)
+	 * to the falloff value between 0 and 1.
+	 */
+	static float EvaluateFalloff(float value);
+
 	/**
 	 * Returns the falloff value at the given x and y coordinate on a falloff
 	 * map with the given size.
@@ -73,6 +94,13 @@ public:
 	UFUNCTION(BlueprintPure, Category = "Unity Library|Camera")
 	static FVector GetCameraLocation(const UObject* worldContextObject);
 
+	/**
+	 * Returns the direction the current player camera looks at. Zero if there is no player camera (e.g. in the editor).
+	 * @param worldContextObject The object's world will be used to look for the player camera. Must not be null.
+	 */
+	UFUNCTION(BlueprintPure, Category = "Unity Library|Camera")
+	static FVector GetCameraDirection(const UObject* worldContextObject);
+
 
 	/////////////////////////////////////////////////////
 					/* Texture */